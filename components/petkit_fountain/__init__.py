@@ -6,5 +6,41 @@ DOMAIN = "petkit_fountain"
 
 CONF_PARENT_ID = "parent_id"
 
+# Manager: share a few BLE connections between many fountains
+CONF_MAX_CONNECTIONS = "max_connections"
+CONF_SESSION_TIMEOUT = "session_timeout"
+CONF_FOUNTAINS = "fountains"
+CONF_FOUNTAIN_ID = "fountain_id"
+CONF_MAX_AGE = "max_age"
+
 petkit_fountain_ns = cg.esphome_ns.namespace("petkit_fountain")
 PetkitFountain = petkit_fountain_ns.class_("PetkitFountain", cg.Component)
+PetkitFountainManager = petkit_fountain_ns.class_("PetkitFountainManager", cg.Component)
+
+FOUNTAIN_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_FOUNTAIN_ID): cv.use_id(PetkitFountain),
+        # freshness target: reconnect once the last session is older than this
+        cv.Optional(CONF_MAX_AGE, default="5min"): cv.positive_time_period_milliseconds,
+    }
+)
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(PetkitFountainManager),
+        cv.Optional(CONF_MAX_CONNECTIONS, default=1): cv.int_range(min=1, max=9),
+        cv.Optional(CONF_SESSION_TIMEOUT, default="30s"): cv.positive_time_period_milliseconds,
+        cv.Required(CONF_FOUNTAINS): cv.All(cv.ensure_list(FOUNTAIN_SCHEMA), cv.Length(min=1)),
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+
+    cg.add(var.set_max_connections(config[CONF_MAX_CONNECTIONS]))
+    cg.add(var.set_session_timeout(config[CONF_SESSION_TIMEOUT]))
+    for conf in config[CONF_FOUNTAINS]:
+        fountain = await cg.get_variable(conf[CONF_FOUNTAIN_ID])
+        cg.add(var.add_fountain(fountain, conf[CONF_MAX_AGE]))
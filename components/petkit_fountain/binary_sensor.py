@@ -10,6 +10,13 @@ CONF_FILTER_WARNING = "filter_warning"
 
 petkit_ns = cg.esphome_ns.namespace("petkit_fountain")
 PetkitFountain = petkit_ns.class_("PetkitFountain")
+PetkitField = petkit_ns.enum("PetkitField")
+
+_FIELDS = {
+    CONF_LACK_WARNING: PetkitField.FIELD_LACK_WARN,
+    CONF_BREAKDOWN_WARNING: PetkitField.FIELD_BREAKDOWN_WARN,
+    CONF_FILTER_WARNING: PetkitField.FIELD_FILTER_WARN,
+}
 
 def _opt_bs():
     return binary_sensor.binary_sensor_schema()
@@ -28,14 +35,7 @@ CONFIG_SCHEMA = cv.Schema(
 async def to_code(config):
     parent = await cg.get_variable(config[CONF_PARENT_ID])
 
-    if CONF_LACK_WARNING in config:
-        bs = await binary_sensor.new_binary_sensor(config[CONF_LACK_WARNING])
-        cg.add(parent.set_lack_warning_binary_sensor(bs))
-
-    if CONF_BREAKDOWN_WARNING in config:
-        bs = await binary_sensor.new_binary_sensor(config[CONF_BREAKDOWN_WARNING])
-        cg.add(parent.set_breakdown_warning_binary_sensor(bs))
-
-    if CONF_FILTER_WARNING in config:
-        bs = await binary_sensor.new_binary_sensor(config[CONF_FILTER_WARNING])
-        cg.add(parent.set_filter_warning_binary_sensor(bs))
+    for key, field in _FIELDS.items():
+        if key in config:
+            bs = await binary_sensor.new_binary_sensor(config[key])
+            cg.add(parent.bind_binary_sensor(field, bs))
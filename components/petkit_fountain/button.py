@@ -10,6 +10,7 @@ CONF_RESET_FILTER = "reset_filter"
 CONF_SET_DATETIME = "set_datetime"
 CONF_INIT_SESSION = "init_session"
 CONF_SYNC = "sync"
+CONF_DUMP_CAPTURE = "dump_capture"
 
 petkit_ns = cg.esphome_ns.namespace("petkit_fountain")
 PetkitFountain = petkit_ns.class_("PetkitFountain")
@@ -25,13 +26,14 @@ CONFIG_SCHEMA = cv.Schema(
         cv.Optional(CONF_SET_DATETIME): button.button_schema(PetkitActionButton),
         cv.Optional(CONF_INIT_SESSION): button.button_schema(PetkitActionButton),
         cv.Optional(CONF_SYNC): button.button_schema(PetkitActionButton),
+        cv.Optional(CONF_DUMP_CAPTURE): button.button_schema(PetkitActionButton),
     }
 )
 
 async def to_code(config):
     parent = await cg.get_variable(config[CONF_PARENT_ID])
 
-    # Action mapping: REFRESH=0 READ_CONFIG=1 RESET_FILTER=2 SET_DATETIME=3 INIT_SESSION=4 SYNC=5
+    # Action mapping: REFRESH=0 READ_CONFIG=1 RESET_FILTER=2 SET_DATETIME=3 INIT_SESSION=4 SYNC=5 DUMP_CAPTURE=6
     if CONF_REFRESH_STATE in config:
         b = await button.new_button(config[CONF_REFRESH_STATE])
         cg.add(b.set_parent(parent))
@@ -67,3 +69,9 @@ async def to_code(config):
         cg.add(b.set_parent(parent))
         cg.add(parent.set_action_button(b))
         cg.add(b.set_action(5))
+
+    if CONF_DUMP_CAPTURE in config:
+        b = await button.new_button(config[CONF_DUMP_CAPTURE])
+        cg.add(b.set_parent(parent))
+        cg.add(parent.set_action_button(b))
+        cg.add(b.set_action(6))
@@ -26,6 +26,19 @@ PetkitTimeNumber = petkit_ns.class_("PetkitTimeNumber", number.Number)
 
 PetkitSmartOnNumber = petkit_ns.class_("PetkitSmartOnNumber", number.Number)
 PetkitSmartOffNumber = petkit_ns.class_("PetkitSmartOffNumber", number.Number)
+PetkitField = petkit_ns.enum("PetkitField")
+
+# config key -> (field, time kind or None)
+# Time kinds: 0=LIGHT_START, 1=LIGHT_END, 2=DND_START, 3=DND_END
+_FIELDS = {
+    CONF_LIGHT_BRIGHTNESS: (PetkitField.FIELD_BRIGHTNESS, None),
+    CONF_LIGHT_SCHEDULE_START_MIN: (PetkitField.FIELD_LIGHT_START, 0),
+    CONF_LIGHT_SCHEDULE_END_MIN: (PetkitField.FIELD_LIGHT_END, 1),
+    CONF_DND_START_MIN: (PetkitField.FIELD_DND_START, 2),
+    CONF_DND_END_MIN: (PetkitField.FIELD_DND_END, 3),
+    CONF_SMART_ON: (PetkitField.FIELD_SMART_ON, None),
+    CONF_SMART_OFF: (PetkitField.FIELD_SMART_OFF, None),
+}
 
 def _num_schema(class_, default_min, default_max, default_step):
     # Allow YAML to override min/max/step
@@ -72,47 +85,9 @@ async def _new_num(cfg):
 async def to_code(config):
     parent = await cg.get_variable(config[CONF_PARENT_ID])
 
-    if CONF_LIGHT_BRIGHTNESS in config:
-        cfg = config[CONF_LIGHT_BRIGHTNESS]
-        n = await _new_num(cfg)
-        cg.add(n.set_parent(parent))
-        cg.add(parent.set_brightness_number(n))
-
-    # Time kinds: 0=LIGHT_START, 1=LIGHT_END, 2=DND_START, 3=DND_END
-    if CONF_LIGHT_SCHEDULE_START_MIN in config:
-        cfg = config[CONF_LIGHT_SCHEDULE_START_MIN]
-        n = await _new_num(cfg)
-        cg.add(n.set_parent(parent))
-        cg.add(n.set_kind(0))
-        cg.add(parent.set_time_number(n))
-
-    if CONF_LIGHT_SCHEDULE_END_MIN in config:
-        cfg = config[CONF_LIGHT_SCHEDULE_END_MIN]
-        n = await _new_num(cfg)
-        cg.add(n.set_parent(parent))
-        cg.add(n.set_kind(1))
-        cg.add(parent.set_time_number(n))
-
-    if CONF_DND_START_MIN in config:
-        cfg = config[CONF_DND_START_MIN]
-        n = await _new_num(cfg)
-        cg.add(n.set_parent(parent))
-        cg.add(n.set_kind(2))
-        cg.add(parent.set_time_number(n))
-
-    if CONF_DND_END_MIN in config:
-        cfg = config[CONF_DND_END_MIN]
-        n = await _new_num(cfg)
-        cg.add(n.set_parent(parent))
-        cg.add(n.set_kind(3))
-        cg.add(parent.set_time_number(n))
-
-    if CONF_SMART_ON in config:
-        cfg = config[CONF_SMART_ON]
-        n = await _new_num(cfg)
-        cg.add(parent.set_smart_on_number(n))
-    
-    if CONF_SMART_OFF in config:
-        cfg = config[CONF_SMART_OFF]
-        n = await _new_num(cfg)
-        cg.add(parent.set_smart_off_number(n))
+    for key, (field, kind) in _FIELDS.items():
+        if key in config:
+            n = await _new_num(config[key])
+            if kind is not None:
+                cg.add(n.set_kind(kind))
+            cg.add(parent.bind_number(field, n))
@@ -0,0 +1,67 @@
+// Allocation counter behind the rx/tx heap sensors (see PetkitHeapStats).
+//
+// Codegen links with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc when one of those sensors
+// is configured, so every call to these (operator new included) lands here first. Only the
+// task that last called petkit_alloc_probe_begin() is counted: the component runs on one task,
+// and allocations of the BLE stack or WiFi on their own tasks stay out of the figures. Calls
+// made from ROM code or straight to heap_caps_malloc() bypass the wrapper.
+#include "esphome/core/defines.h"
+
+#ifdef USE_PETKIT_ALLOC_PROBE
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "petkit_codec.h"
+
+extern "C" {
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+}
+
+namespace esphome {
+namespace petkit_fountain {
+
+static TaskHandle_t probe_task = nullptr;
+static PetkitAllocCount probe_totals;
+
+static inline void probe_count(const void *ptr, size_t size) {
+  if (ptr == nullptr || probe_task == nullptr || xTaskGetCurrentTaskHandle() != probe_task) return;
+  probe_totals.allocs++;
+  probe_totals.bytes += uint32_t(size);
+}
+
+PetkitAllocCount petkit_alloc_probe_begin() {
+  probe_task = xTaskGetCurrentTaskHandle();
+  return probe_totals;
+}
+
+PetkitAllocCount petkit_alloc_probe_totals() { return probe_totals; }
+
+}  // namespace petkit_fountain
+}  // namespace esphome
+
+extern "C" {
+
+void *__wrap_malloc(size_t size) {
+  void *p = __real_malloc(size);
+  esphome::petkit_fountain::probe_count(p, size);
+  return p;
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+  void *p = __real_calloc(n, size);
+  esphome::petkit_fountain::probe_count(p, n * size);
+  return p;
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  void *p = __real_realloc(ptr, size);
+  esphome::petkit_fountain::probe_count(p, size);
+  return p;
+}
+
+}  // extern "C"
+
+#endif  // USE_PETKIT_ALLOC_PROBE
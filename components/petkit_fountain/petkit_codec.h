@@ -0,0 +1,1228 @@
+#pragma once
+
+// Petkit BLE protocol codec: framing, parsing and encoding.
+//
+// This header is transport independent on purpose. It only depends on the C++
+// standard library so it can be compiled and profiled on a host as well as on
+// the ESP32 (no esphome.h, no esp_gattc_api.h in here).
+//
+// Parsers only read f.data[0, data_len): petkit_decode_frame_() ties data_len to the
+// frame length, each parser checks its minimum length, and the static_asserts next to
+// each layout keep the fixed offsets inside that minimum.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace esphome {
+namespace petkit_fountain {
+
+// Frame layout: FA FC FD <cmd> <type> <seq> <len> <start> <data...> FB
+static constexpr uint8_t PETKIT_HDR0 = 0xFA;
+static constexpr uint8_t PETKIT_HDR1 = 0xFC;
+static constexpr uint8_t PETKIT_HDR2 = 0xFD;
+static constexpr uint8_t PETKIT_END = 0xFB;
+
+static constexpr uint8_t PETKIT_TYPE_REQUEST = 0x01;
+static constexpr uint8_t PETKIT_TYPE_RESPONSE = 0x02;
+
+// 3 header + cmd/type/seq/len/start + end
+static constexpr size_t PETKIT_FRAME_OVERHEAD = 9;
+static constexpr size_t PETKIT_DATA_OFFSET = 8;
+
+static inline uint16_t petkit_u16_be_(const uint8_t *p) { return (uint16_t(p[0]) << 8) | uint16_t(p[1]); }
+static inline uint32_t petkit_u32_be_(const uint8_t *p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+static inline bool petkit_is_printable_ascii_(uint8_t b) {
+  return (b >= 0x20 && b <= 0x7E);
+}
+
+// Validated view of one frame. All parsers below take this view, so header, end byte
+// and declared length are checked once by petkit_decode_frame_().
+struct PetkitFrame {
+  uint8_t cmd{0};
+  uint8_t type{0};
+  uint8_t seq{0};
+  uint8_t data_len{0};
+  const uint8_t *data{nullptr};  // data_len bytes
+};
+
+static inline bool petkit_decode_frame_(const uint8_t *frame, size_t len, PetkitFrame &out) {
+  if (len < PETKIT_FRAME_OVERHEAD) return false;
+  if (frame[0] != PETKIT_HDR0 || frame[1] != PETKIT_HDR1 || frame[2] != PETKIT_HDR2) return false;
+  if (frame[len - 1] != PETKIT_END) return false;
+  if (len != PETKIT_FRAME_OVERHEAD + frame[6]) return false;
+
+  out.cmd = frame[3];
+  out.type = frame[4];
+  out.seq = frame[5];
+  out.data_len = frame[6];
+  // frame[7] is data_start, expected 0; not strictly required
+  out.data = frame + PETKIT_DATA_OFFSET;
+  return true;
+}
+
+// Longest data length accepted per command byte. A header declaring more is garbage, so a
+// corrupted length byte cannot hold back the frames queued behind it.
+static constexpr size_t petkit_max_data_len_(uint8_t cmd) {
+  switch (cmd) {
+    case 0xD5: return 64;  // 2 + device id + serial
+    case 0xE6: return 64;  // 29..34 seen
+    case 0xD3: return 13;  // PETKIT_CONFIG_LEN
+    default: return 32;    // D2 (12), ACKs (1), unknown commands
+  }
+}
+
+// ---------------- Streaming framer ----------------
+// Reassembles FA FC FD ... FB frames from a BLE notification stream. A frame may be
+// split across notifications, several frames may share one notification, and
+// garbage between frames is skipped. Fixed buffer, no heap.
+class PetkitFramer {
+ public:
+  // Fits the longest frame petkit_max_data_len_() lets through.
+  static constexpr size_t BUFFER_SIZE = 128;
+  // A partial frame older than this is given up when the next chunk arrives; the bytes
+  // after its first are rescanned, since valid frames may sit behind a bogus header.
+  static constexpr uint32_t STALE_MS = 1000;
+
+  // Feeds one notification. `on_frame(const uint8_t *frame, size_t len)` is called once per
+  // complete frame, in order.
+  template<typename F> void feed(const uint8_t *data, size_t len, uint32_t now_ms, F &&on_frame) {
+    chunk_id_++;
+    if (len_ > 0 && (uint32_t) (now_ms - last_ms_) > STALE_MS) resync_(on_frame);
+    last_ms_ = now_ms;
+    for (size_t i = 0; i < len; i++) {
+      if (step_(data[i], on_frame) == STEP_BAD) resync_(on_frame);
+    }
+  }
+
+  void reset() { len_ = 0; }
+
+  uint32_t get_frames() const { return frames_; }
+  uint32_t get_reassembled() const { return reassembled_; }
+  uint32_t get_dropped() const { return dropped_; }
+  uint32_t get_garbage_bytes() const { return garbage_bytes_; }
+
+ protected:
+  enum Step : uint8_t { STEP_OK, STEP_FRAME, STEP_BAD };
+
+  template<typename F> Step step_(uint8_t b, F &&on_frame) {
+    if (len_ == 0) {
+      if (b != PETKIT_HDR0) {
+        garbage_bytes_++;
+        return STEP_OK;
+      }
+      frame_chunk_ = chunk_id_;
+      buf_[len_++] = b;
+      return STEP_OK;
+    }
+
+    buf_[len_++] = b;
+    if (len_ == 2) return b == PETKIT_HDR1 ? STEP_OK : STEP_BAD;
+    if (len_ == 3) return b == PETKIT_HDR2 ? STEP_OK : STEP_BAD;
+    if (len_ == 7) {
+      if (b > petkit_max_data_len_(buf_[3])) return STEP_BAD;
+      expected_ = PETKIT_FRAME_OVERHEAD + b;
+    }
+    if (len_ < 7 || len_ < expected_) return STEP_OK;
+
+    if (b != PETKIT_END) return STEP_BAD;
+    frames_++;
+    if (frame_chunk_ != chunk_id_) reassembled_++;
+    on_frame(buf_.data(), len_);
+    len_ = 0;
+    return STEP_FRAME;
+  }
+
+  // The buffered candidate was not a frame: drop its first byte and rescan the rest,
+  // since a real header may start inside it.
+  template<typename F> void resync_(F &&on_frame) {
+    if (len_ > 3) dropped_++;
+    else garbage_bytes_++;
+
+    std::array<uint8_t, BUFFER_SIZE> replay;
+    const size_t n = len_ - 1;
+    std::copy(buf_.begin() + 1, buf_.begin() + len_, replay.begin());
+    len_ = 0;
+
+    size_t start = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (len_ == 0) start = i;
+      if (step_(replay[i], on_frame) != STEP_BAD) continue;
+      if (len_ > 3) dropped_++;
+      else garbage_bytes_++;
+      len_ = 0;
+      i = start;  // resume right after the rejected start byte
+    }
+  }
+
+  std::array<uint8_t, BUFFER_SIZE> buf_{};
+  size_t len_{0};
+  size_t expected_{0};
+  uint32_t last_ms_{0};
+  uint32_t chunk_id_{0};
+  uint32_t frame_chunk_{0};
+
+  uint32_t frames_{0};
+  uint32_t reassembled_{0};
+  uint32_t dropped_{0};
+  uint32_t garbage_bytes_{0};
+};
+static_assert(PETKIT_FRAME_OVERHEAD + petkit_max_data_len_(0xD5) <= PetkitFramer::BUFFER_SIZE &&
+                  PETKIT_FRAME_OVERHEAD + petkit_max_data_len_(0xE6) <= PetkitFramer::BUFFER_SIZE &&
+                  PETKIT_FRAME_OVERHEAD + petkit_max_data_len_(0x00) <= PetkitFramer::BUFFER_SIZE,
+              "framer buffer shorter than an accepted frame");
+
+// Length-tagged string stored inline (no heap). Longer input is truncated to N.
+template<size_t N> struct PetkitInlineString {
+  static_assert(N < 256, "length is a uint8_t");
+  uint8_t len{0};
+  char buf[N + 1]{};
+
+  void assign(const char *s, size_t n) {
+    if (n > N) n = N;
+    memcpy(buf, s, n);
+    buf[n] = '\0';
+    len = (uint8_t) n;
+  }
+  void assign(const char *s) { assign(s, strnlen(s, N)); }
+  bool empty() const { return len == 0; }
+  size_t size() const { return len; }
+  const char *c_str() const { return buf; }
+  bool operator==(const PetkitInlineString &o) const { return len == o.len && memcmp(buf, o.buf, len) == 0; }
+  bool operator!=(const PetkitInlineString &o) const { return !(*this == o); }
+};
+
+// ---------------- CMD213 (0xD5): device identifiers ----------------
+static constexpr size_t PETKIT_D5_MIN_LEN = 8;
+static constexpr size_t PETKIT_DEVICE_ID_LEN = 6;
+static constexpr size_t PETKIT_SERIAL_MAX = 25;  // fits the identity cache with its terminator
+
+using PetkitDeviceId = std::array<uint8_t, PETKIT_DEVICE_ID_LEN>;
+using PetkitSerial = PetkitInlineString<PETKIT_SERIAL_MAX>;
+
+struct Petkit213Info {
+  bool ok{false};
+  uint8_t cmd{0};
+  uint8_t type{0};
+  uint8_t seq{0};
+  uint8_t data_len{0};
+
+  PetkitDeviceId device_id_bytes{};  // data[2:8]
+  uint64_t device_id_int{0};         // big endian from those 6 bytes
+  PetkitSerial serial;               // printable ASCII run, truncated to PETKIT_SERIAL_MAX
+};
+static_assert(sizeof(PetkitSerial) == PETKIT_SERIAL_MAX + 2, "PetkitSerial is len + chars + NUL");
+static_assert(sizeof(Petkit213Info) <= 64, "Petkit213Info is returned by value per CMD213");
+
+static inline Petkit213Info petkit_parse_cmd213_(const PetkitFrame &f) {
+  Petkit213Info out;
+
+  out.cmd = f.cmd;
+  out.type = f.type;
+  out.seq = f.seq;
+  out.data_len = f.data_len;
+
+  if (out.cmd != 0xD5) return out;  // 213
+
+  const uint8_t *data = f.data;
+  const size_t dlen = f.data_len;
+
+  // Python does: device_id_bytes = data[2:8] (6 bytes)
+  static_assert(2 + PETKIT_DEVICE_ID_LEN <= PETKIT_D5_MIN_LEN, "device id past PETKIT_D5_MIN_LEN");
+  if (dlen < PETKIT_D5_MIN_LEN) return out;
+  std::copy(data + 2, data + 2 + PETKIT_DEVICE_ID_LEN, out.device_id_bytes.begin());
+
+  out.device_id_int = 0;
+  for (auto b : out.device_id_bytes) out.device_id_int = (out.device_id_int << 8) | (uint64_t) b;
+
+  // Extract longest printable ASCII run (serial sits at tail for CTW2)
+  size_t best_start = 0, best_len = 0;
+  size_t cur_start = 0, cur_len = 0;
+
+  for (size_t i = 0; i < dlen; i++) {
+    if (petkit_is_printable_ascii_(data[i])) {
+      if (cur_len == 0) cur_start = i;
+      cur_len++;
+      if (cur_len > best_len) {
+        best_len = cur_len;
+        best_start = cur_start;
+      }
+    } else {
+      cur_len = 0;
+    }
+  }
+
+  if (best_len >= 6) {
+    out.serial.assign(reinterpret_cast<const char *>(data + best_start), best_len);
+  }
+
+  out.ok = true;
+  return out;
+}
+
+// ---------------- CMD210 response (0xD2): state ----------------
+// Need at least up to filter_percent/run_status indices we use
+static constexpr size_t PETKIT_D2_MIN_LEN = 12;
+
+struct PetkitStateD2 {
+  bool ok{false};
+  uint8_t seq{0};
+
+  uint8_t power{0};
+  uint8_t mode{0};
+  uint8_t night_dnd{0};
+  uint8_t breakdown_warn{0};
+  uint8_t lack_warn{0};
+  uint8_t filter_warn{0};
+
+  uint8_t filter_percent{0};
+  uint8_t run_status{0};
+};
+
+// ---------------- CMD211 response (0xD3): configuration ----------------
+static constexpr size_t PETKIT_CONFIG_LEN = 13;
+
+struct PetkitConfigD3 {
+  bool ok{false};
+  uint8_t seq{0};
+
+  uint8_t smart_on{0};
+  uint8_t smart_off{0};
+
+  uint8_t light_sw{0};
+  uint8_t brightness{0};
+  uint16_t light_start{0};
+  uint16_t light_end{0};
+
+  uint8_t dnd_sw{0};
+  uint16_t dnd_start{0};
+  uint16_t dnd_end{0};
+};
+
+// Layout (13 bytes), shared by D3, the E6 settings block and CMD221:
+// 0 smart_on, 1 smart_off, 2 light_sw, 3 brightness,
+// 4..5 light_start, 6..7 light_end,
+// 8 dnd_sw, 9..10 dnd_start, 11..12 dnd_end
+static inline void petkit_decode_config_(const uint8_t *d, PetkitConfigD3 &out) {
+  out.smart_on    = d[0];
+  out.smart_off   = d[1];
+  out.light_sw    = d[2];
+  out.brightness  = d[3];
+  out.light_start = petkit_u16_be_(d + 4);
+  out.light_end   = petkit_u16_be_(d + 6);
+  out.dnd_sw      = d[8];
+  out.dnd_start   = petkit_u16_be_(d + 9);
+  out.dnd_end     = petkit_u16_be_(d + 11);
+}
+
+static inline PetkitConfigD3 petkit_parse_config_d3_(const PetkitFrame &f) {
+  PetkitConfigD3 out;
+  if (f.cmd != 0xD3) return out;
+  if (f.type != PETKIT_TYPE_RESPONSE) return out;
+
+  // Expected config payload length = 13 bytes
+  if (f.data_len != PETKIT_CONFIG_LEN) return out;
+
+  out.seq = f.seq;
+  petkit_decode_config_(f.data, out);
+
+  out.ok = true;
+  return out;
+}
+
+// ---------------- 0xE6: periodic state + settings push ----------------
+// Data offsets (frame offset - 8). The settings block ends at 28; optional
+// extended fields follow on some firmwares.
+static constexpr size_t PETKIT_E6_MIN_LEN = 29;
+static constexpr size_t PETKIT_E6_PURIFIED_OFFSET = 29;
+static constexpr size_t PETKIT_E6_ENERGY_OFFSET = 30;
+
+struct PetkitStateE6 {
+  bool ok{false};
+
+  uint8_t power{0};
+  uint8_t mode{0};
+  uint8_t night_dnd{0};
+  uint8_t breakdown_warn{0};
+  uint8_t lack_warn{0};
+  uint8_t filter_warn{0};
+
+  uint32_t pump_runtime{0};
+  uint8_t filter_percent{0};
+  uint8_t run_status{0};
+  uint32_t today_runtime{0};
+
+  PetkitConfigD3 config{};
+
+  // Optional extended fields on some firmwares.
+  bool has_purified_times{false};
+  uint8_t today_purified_times{0};
+  bool has_energy{false};
+  uint32_t energy_raw{0};
+};
+
+// ---------------- Model profiles ----------------
+// Frame layout per fountain family as a trait type; the D2/E6 parsers are instantiated
+// per profile, so a fixed profile reads its fields at compile-time offsets without looking
+// at the frame length. All offsets are data offsets (frame offset - 8). The D3 / CMD221
+// settings block is the same on every model.
+//
+// Captures so far only differ in the E6 tail (purified times + energy after the settings
+// block). CTW3 follows the CTW2 layout until a capture shows otherwise.
+// W5 / W4X: E6 ends after the settings block. No capture of these models exists yet;
+// the layout is the CTW2 one without the tail and is unverified.
+struct PetkitProfileW5 {
+  static constexpr const char *NAME = "w5";
+  static constexpr bool AUTO = false;
+
+  static constexpr size_t D2_MIN_LEN = 12;
+  static constexpr size_t D2_FILTER_PERCENT = 10;
+  static constexpr size_t D2_RUN_STATUS = 11;
+
+  static constexpr size_t E6_PUMP_RUNTIME = 6;  // u32 BE
+  static constexpr size_t E6_FILTER_PERCENT = 10;
+  static constexpr size_t E6_RUN_STATUS = 11;
+  static constexpr size_t E6_TODAY_RUNTIME = 12;  // u32 BE
+  static constexpr size_t E6_CONFIG = 16;         // PETKIT_CONFIG_LEN bytes
+  static constexpr size_t E6_MIN_LEN = PETKIT_E6_MIN_LEN;
+  static constexpr bool E6_TAIL = false;
+};
+
+struct PetkitProfileCTW2 : PetkitProfileW5 {  // E6 with purified times + energy
+  static constexpr const char *NAME = "ctw2";
+  static constexpr size_t E6_MIN_LEN = PETKIT_E6_ENERGY_OFFSET + 4;
+  static constexpr bool E6_TAIL = true;
+};
+
+struct PetkitProfileCTW3 : PetkitProfileCTW2 {
+  static constexpr const char *NAME = "ctw3";
+};
+
+// Reads the tail only when the frame is long enough; the component reports what it saw.
+struct PetkitProfileAuto : PetkitProfileW5 {
+  static constexpr const char *NAME = "auto";
+  static constexpr bool AUTO = true;
+};
+
+// Fixed profile whose E6 layout covers a frame of this length: nullptr when none does.
+// 30..33 bytes carry the purified byte but not the energy word, which no fixed profile reads.
+static constexpr const char *petkit_profile_for_e6_len_(size_t e6_len) {
+  if (e6_len >= PetkitProfileCTW2::E6_MIN_LEN) return PetkitProfileCTW2::NAME;
+  if (e6_len == PetkitProfileW5::E6_MIN_LEN) return PetkitProfileW5::NAME;
+  return nullptr;
+}
+
+template<typename P> static PetkitStateD2 petkit_parse_state_d2_t_(const PetkitFrame &f) {
+  static_assert(P::D2_MIN_LEN >= 6 && P::D2_FILTER_PERCENT < P::D2_MIN_LEN && P::D2_RUN_STATUS < P::D2_MIN_LEN,
+                "D2 offset past D2_MIN_LEN");
+  PetkitStateD2 out;
+  if (f.cmd != 0xD2) return out;
+  if (f.type != PETKIT_TYPE_RESPONSE) return out;
+  if (f.data_len < P::D2_MIN_LEN) return out;
+
+  const uint8_t *d = f.data;
+
+  out.seq = f.seq;
+  out.power = d[0];
+  out.mode = d[1];
+  out.night_dnd = d[2];
+  out.breakdown_warn = d[3];
+  out.lack_warn = d[4];
+  out.filter_warn = d[5];
+
+  out.filter_percent = d[P::D2_FILTER_PERCENT];
+  out.run_status = d[P::D2_RUN_STATUS];
+
+  out.ok = true;
+  return out;
+}
+
+template<typename P> static PetkitStateE6 petkit_parse_state_e6_t_(const PetkitFrame &f) {
+  static_assert(P::E6_PUMP_RUNTIME + 4 <= P::E6_MIN_LEN && P::E6_FILTER_PERCENT < P::E6_MIN_LEN &&
+                    P::E6_RUN_STATUS < P::E6_MIN_LEN && P::E6_TODAY_RUNTIME + 4 <= P::E6_MIN_LEN &&
+                    P::E6_CONFIG + PETKIT_CONFIG_LEN <= P::E6_MIN_LEN,
+                "E6 offset past E6_MIN_LEN");
+  static_assert(!P::E6_TAIL || PETKIT_E6_ENERGY_OFFSET + 4 <= P::E6_MIN_LEN, "E6 tail past E6_MIN_LEN");
+  PetkitStateE6 out;
+  if (f.cmd != 0xE6) return out;
+  if (f.data_len < P::E6_MIN_LEN) return out;
+
+  const uint8_t *d = f.data;
+
+  out.power = d[0];
+  out.mode  = d[1];
+
+  out.night_dnd = d[2];
+  out.breakdown_warn = d[3];
+  out.lack_warn = d[4];
+  out.filter_warn = d[5];
+
+  out.pump_runtime = petkit_u32_be_(d + P::E6_PUMP_RUNTIME);
+  out.filter_percent = d[P::E6_FILTER_PERCENT];
+  out.run_status = d[P::E6_RUN_STATUS];
+  out.today_runtime = petkit_u32_be_(d + P::E6_TODAY_RUNTIME);
+
+  // --- settings block (same layout as D3 / CMD221) ---
+  petkit_decode_config_(d + P::E6_CONFIG, out.config);
+  out.config.seq = f.seq;
+  out.config.ok = true;
+
+  if constexpr (P::AUTO) {
+    // Only read the extended fields when the declared length covers them
+    // (never the end byte).
+    if (f.data_len > PETKIT_E6_PURIFIED_OFFSET) {
+      out.has_purified_times = true;
+      out.today_purified_times = d[PETKIT_E6_PURIFIED_OFFSET];
+    }
+    if (f.data_len >= PETKIT_E6_ENERGY_OFFSET + 4) {
+      out.has_energy = true;
+      out.energy_raw = petkit_u32_be_(d + PETKIT_E6_ENERGY_OFFSET);
+    }
+  } else if constexpr (P::E6_TAIL) {
+    out.has_purified_times = true;
+    out.today_purified_times = d[PETKIT_E6_PURIFIED_OFFSET];
+    out.has_energy = true;
+    out.energy_raw = petkit_u32_be_(d + PETKIT_E6_ENERGY_OFFSET);
+  }
+
+  out.ok = true;
+  return out;
+}
+
+// Every frame a parser accepts must get through the framer.
+static_assert(PETKIT_D5_MIN_LEN <= petkit_max_data_len_(0xD5), "D5 longer than the framer accepts");
+static_assert(PetkitProfileCTW2::E6_MIN_LEN <= petkit_max_data_len_(0xE6), "E6 longer than the framer accepts");
+static_assert(PetkitProfileW5::D2_MIN_LEN <= petkit_max_data_len_(0xD2), "D2 longer than the framer accepts");
+static_assert(PETKIT_CONFIG_LEN == petkit_max_data_len_(0xD3), "D3 length differs from the framer bound");
+
+// Length-probing parsers (auto profile)
+static inline PetkitStateD2 petkit_parse_state_d2_(const PetkitFrame &f) {
+  return petkit_parse_state_d2_t_<PetkitProfileAuto>(f);
+}
+static inline PetkitStateE6 petkit_parse_state_e6_(const PetkitFrame &f) {
+  return petkit_parse_state_e6_t_<PetkitProfileAuto>(f);
+}
+
+// ---------------- Usage accounting ----------------
+// The E6 "today" counters (pump seconds, purified cycles, energy) restart whenever the
+// device decides its day is over. PetkitUsageAccumulator turns successive samples into
+// deltas and keeps lifetime and per-day totals that only grow; the day is the caller's
+// local date, not the device's.
+struct PetkitUsageTotals {
+  uint32_t pump_s{0};
+  uint32_t cycles{0};
+  uint32_t energy_raw{0};
+};
+
+struct PetkitUsageSample {
+  uint32_t pump_s{0};
+  uint32_t energy_raw{0};
+  uint8_t cycles{0};
+  bool has_cycles{false};
+  bool has_energy{false};
+};
+
+class PetkitUsageAccumulator {
+ public:
+  // pump seconds may run ahead of our clock by this much before a jump counts as a glitch
+  static constexpr uint32_t CLOCK_SLACK_S = 120;
+
+  PetkitUsageTotals lifetime;
+  PetkitUsageTotals today;
+  uint32_t day{0};     // day key of `today`, 0 = unknown
+  uint32_t resets{0};  // device-side counter restarts seen
+  PetkitUsageSample last;
+  bool has_last{false};
+
+  // Adds one sample; false if no total changed. day_key: caller's local date (0 = clock not
+  // set, no rollover). elapsed_s: wall time since the previous sample (0 = unknown, e.g.
+  // the first sample after boot), used to reject jumps the pump cannot have run.
+  bool add(const PetkitUsageSample &s, uint32_t day_key, uint32_t elapsed_s) {
+    const bool changed = roll_day(day_key);
+    if (!has_last) {
+      last = s;
+      has_last = true;
+      return changed;  // baseline only
+    }
+
+    uint32_t d_pump;
+    if (s.pump_s >= last.pump_s) {
+      d_pump = s.pump_s - last.pump_s;
+    } else {
+      d_pump = s.pump_s;  // device restarted its day
+      resets++;
+    }
+    if (elapsed_s != 0 && d_pump > elapsed_s + CLOCK_SLACK_S) d_pump = 0;  // glitch: rebase only
+    const bool reset = s.pump_s < last.pump_s;
+
+    uint32_t d_cycles = 0;
+    if (s.has_cycles && last.has_cycles) {
+      if (s.cycles >= last.cycles) {
+        d_cycles = s.cycles - last.cycles;
+      } else if (!reset && last.cycles >= 0xF0) {
+        d_cycles = 0x100u - last.cycles + s.cycles;  // 8-bit wrap
+      } else {
+        d_cycles = s.cycles;
+      }
+    }
+
+    uint32_t d_energy = 0;
+    if (s.has_energy && last.has_energy) d_energy = s.energy_raw >= last.energy_raw ? s.energy_raw - last.energy_raw : s.energy_raw;
+
+    last = s;
+    if (d_pump == 0 && d_cycles == 0 && d_energy == 0) return changed;
+    lifetime.pump_s += d_pump;
+    lifetime.cycles += d_cycles;
+    lifetime.energy_raw += d_energy;
+    today.pump_s += d_pump;
+    today.cycles += d_cycles;
+    today.energy_raw += d_energy;
+    return true;
+  }
+
+  // Starts a new `today` when the local date changes; true if a non-zero day was closed.
+  bool roll_day(uint32_t day_key) {
+    if (day_key == 0 || day_key == day) return false;
+    const bool had = day != 0 && (today.pump_s != 0 || today.cycles != 0 || today.energy_raw != 0);
+    today = PetkitUsageTotals{};
+    day = day_key;
+    return had;
+  }
+};
+
+// ---------------- Filter life estimate ----------------
+// Least-squares fit of filter percent against pump runtime, from running sums (O(1) per
+// point). A point is taken each time the percent drops; pump hours per calendar day turn
+// the fitted rate into days. A percent increase (filter replaced) or a pump counter that
+// goes back (other device) restarts the fit. `state` is plain data for persisting.
+class PetkitFilterEstimator {
+ public:
+  static constexpr uint32_t MIN_POINTS = 4;
+  static constexpr uint32_t MIN_SPAN_S = 86400;  // calendar time needed for the usage rate
+  static constexpr float MAX_DAYS = 365.0f;      // cap for an open-ended upper band
+
+  struct State {
+    double sx, sy, sxx, sxy, syy;  // x = pump hours since pump0_s, y = percent
+    uint32_t n;
+    uint32_t pump0_s;
+    uint32_t t0;  // unix time of the first point
+    uint32_t last_t;
+    uint32_t last_pump_s;
+    uint8_t last_percent;
+    uint8_t reserved[3];
+  };
+
+  struct Estimate {
+    bool ok{false};
+    float days{0};
+    float days_low{0};
+    float days_high{0};
+    float pct_per_pump_hour{0};
+  };
+
+  State state{};
+
+  // One E6 sample; true if a fit point was added (state worth persisting).
+  bool add(uint32_t unix_s, uint32_t pump_s, uint8_t percent) {
+    State &st = state;
+    if (st.n != 0 && (percent > st.last_percent || pump_s < st.last_pump_s)) reset();
+    if (st.n != 0 && percent == st.last_percent) {
+      st.last_t = unix_s;
+      st.last_pump_s = pump_s;
+      return false;
+    }
+    if (st.n == 0) {
+      st.pump0_s = pump_s;
+      st.t0 = unix_s;
+    }
+    const double x = (double) (pump_s - st.pump0_s) / 3600.0;
+    const double y = percent;
+    st.n++;
+    st.sx += x;
+    st.sy += y;
+    st.sxx += x * x;
+    st.sxy += x * y;
+    st.syy += y * y;
+    st.last_t = unix_s;
+    st.last_pump_s = pump_s;
+    st.last_percent = percent;
+    return true;
+  }
+
+  void reset() { state = State{}; }
+
+  // Days until `percent_now` reaches 0, with a ~95% band from the slope's standard error.
+  Estimate estimate(uint8_t percent_now) const {
+    Estimate e;
+    const State &st = state;
+    if (st.n < MIN_POINTS || (st.last_t - st.t0) < MIN_SPAN_S) return e;
+    const double n = st.n;
+    const double sxx_c = st.sxx - st.sx * st.sx / n;
+    if (sxx_c <= 0.0) return e;
+    const double b = (st.sxy - st.sx * st.sy / n) / sxx_c;
+    if (b >= 0.0) return e;
+    const double ss = std::max(0.0, st.syy - st.sy * st.sy / n - b * (st.sxy - st.sx * st.sy / n));
+    const double se = std::sqrt(ss / (n - 2) / sxx_c);
+    if (2.0 * se >= -b) return e;  // rate not significant yet
+
+    const double pump_h_per_day = (double) (st.last_pump_s - st.pump0_s) / 3600.0 / ((double) (st.last_t - st.t0) / 86400.0);
+    if (pump_h_per_day <= 0.0) return e;
+
+    auto days = [&](double rate) { return (float) std::min<double>(MAX_DAYS, percent_now / rate / pump_h_per_day); };
+    e.ok = true;
+    e.pct_per_pump_hour = (float) -b;
+    e.days = days(-b);
+    e.days_low = days(-b + 2.0 * se);
+    e.days_high = days(-b - 2.0 * se);
+    return e;
+  }
+};
+
+// ---------------- Generic ACK ----------------
+// Format: FA FC FD <cmd> 02 <seq> 01 00 <status> FB
+struct PetkitAck {
+  bool ok{false};
+  uint8_t cmd{0};
+  uint8_t seq{0};
+  uint8_t value{0};  // usually 1 = ok
+};
+
+static inline PetkitAck petkit_parse_ack_(const PetkitFrame &f) {
+  PetkitAck out;
+  if (f.type != PETKIT_TYPE_RESPONSE) return out;
+  if (f.data_len < 1) return out;
+
+  out.ok = true;
+  out.cmd = f.cmd;
+  out.seq = f.seq;
+  out.value = f.data[0];
+  return out;
+}
+
+// ---------------- Encoding ----------------
+// Largest TX payload is CMD73: [0,0] + device_id(8) + secret(8)
+static constexpr size_t PETKIT_MAX_PAYLOAD = 18;
+static constexpr size_t PETKIT_MAX_TX_FRAME = PETKIT_FRAME_OVERHEAD + PETKIT_MAX_PAYLOAD;
+static constexpr size_t PETKIT_SEQ_OFFSET = 5;
+
+// Encodes one frame into `out` (capacity `cap`). Returns the frame length, 0 if it does not fit.
+static inline size_t petkit_encode_cmd_(uint8_t *out, size_t cap, uint8_t seq, uint8_t cmd, uint8_t type,
+                                        const uint8_t *data, size_t len) {
+  if (len > 0xFF || cap < PETKIT_FRAME_OVERHEAD + len) return 0;
+
+  out[0] = PETKIT_HDR0;
+  out[1] = PETKIT_HDR1;
+  out[2] = PETKIT_HDR2;
+  out[3] = cmd;
+  out[4] = type;
+  out[5] = seq;
+  out[6] = (uint8_t) len;
+  out[7] = 0x00;                    // data_start
+  for (size_t i = 0; i < len; i++) out[PETKIT_DATA_OFFSET + i] = data[i];
+  out[PETKIT_DATA_OFFSET + len] = PETKIT_END;  // end_byte
+
+  return PETKIT_FRAME_OVERHEAD + len;
+}
+
+// Prebuilt request frame with data=[0,0]; only the seq byte is patched before sending.
+static constexpr size_t PETKIT_READ_FRAME_LEN = PETKIT_FRAME_OVERHEAD + 2;
+using PetkitReadTemplate = std::array<uint8_t, PETKIT_READ_FRAME_LEN>;
+
+static constexpr PetkitReadTemplate petkit_make_read_template_(uint8_t cmd) {
+  return PetkitReadTemplate{PETKIT_HDR0, PETKIT_HDR1, PETKIT_HDR2, cmd, PETKIT_TYPE_REQUEST, 0x00, 0x02, 0x00,
+                            0x00, 0x00, PETKIT_END};
+}
+
+// CMD84 payload size, see petkit_build_time_bytes_()
+static constexpr size_t PETKIT_TIME_PAYLOAD_LEN = 6;
+
+// Payload like Python Utils.time_in_bytes():
+// [0, sec>>24, sec>>16, sec>>8, sec, 13]
+// sec = seconds since 2000-01-01 00:00:00 UTC
+static inline std::array<uint8_t, PETKIT_TIME_PAYLOAD_LEN> petkit_build_time_bytes_(time_t now_unix) {
+  // 2000-01-01 00:00:00 UTC in Unix epoch seconds
+  const int64_t unix_to_2000 = 946684800LL;
+
+  int64_t sec2000 = (int64_t) now_unix - unix_to_2000;
+  if (sec2000 < 0) sec2000 = 0;  // clamp if clock not set
+
+  uint32_t s = (uint32_t) sec2000;
+
+  return {0x00, uint8_t((s >> 24) & 0xFF), uint8_t((s >> 16) & 0xFF), uint8_t((s >> 8) & 0xFF),
+          uint8_t(s & 0xFF), 0x0D};  // 13
+}
+
+// ---------------- TX queue ----------------
+// Queued command with its payload stored inline, so queueing never touches the heap.
+struct PetkitPendingCmd {
+  uint8_t cmd{0};
+  uint8_t type{0};
+  uint8_t len{0};
+  bool read_template{false};  // data=[0,0] request, sent from a prebuilt frame
+  std::array<uint8_t, PETKIT_MAX_PAYLOAD> data{};
+};
+
+// Fixed-capacity FIFO ring of pending commands.
+template<size_t N> class PetkitTxRing {
+ public:
+  bool empty() const { return count_ == 0; }
+  bool full() const { return count_ == N; }
+  size_t size() const { return count_; }
+  static constexpr size_t capacity() { return N; }
+
+  // Returns a slot at the tail to fill in place, or nullptr when full.
+  PetkitPendingCmd *push() {
+    if (full()) return nullptr;
+    PetkitPendingCmd *slot = &items_[(head_ + count_) % N];
+    count_++;
+    return slot;
+  }
+
+  PetkitPendingCmd &front() { return items_[head_]; }
+
+  bool contains(uint8_t cmd) const {
+    for (size_t i = 0; i < count_; i++)
+      if (items_[(head_ + i) % N].cmd == cmd) return true;
+    return false;
+  }
+
+  void pop() {
+    if (empty()) return;
+    head_ = (head_ + 1) % N;
+    count_--;
+  }
+
+  void clear() { head_ = count_ = 0; }
+
+ protected:
+  std::array<PetkitPendingCmd, N> items_{};
+  size_t head_{0};
+  size_t count_{0};
+};
+
+// Send order: control writes first, then session/init, then polling reads.
+enum PetkitTxPrio : uint8_t { PETKIT_PRIO_CONTROL = 0, PETKIT_PRIO_SESSION, PETKIT_PRIO_POLL, PETKIT_PRIO_COUNT };
+
+static constexpr PetkitTxPrio petkit_tx_prio_(uint8_t cmd) {
+  return (cmd == 220 || cmd == 221 || cmd == 222) ? PETKIT_PRIO_CONTROL
+         : (cmd == 210 || cmd == 211 || cmd == 66) ? PETKIT_PRIO_POLL
+                                                    : PETKIT_PRIO_SESSION;
+}
+
+// One FIFO ring per priority class; peek() is the oldest command of the highest class,
+// optionally skipping the classes above `from`.
+template<size_t N> class PetkitTxQueue {
+ public:
+  bool empty() const { return size() == 0; }
+  bool empty(PetkitTxPrio prio) const { return rings_[prio].empty(); }
+  size_t size() const {
+    size_t n = 0;
+    for (const auto &r : rings_) n += r.size();
+    return n;
+  }
+  static constexpr size_t capacity() { return N * PETKIT_PRIO_COUNT; }
+
+  PetkitPendingCmd *push(PetkitTxPrio prio) { return rings_[prio].push(); }
+
+  PetkitPendingCmd *peek(PetkitTxPrio from = PETKIT_PRIO_CONTROL) {
+    const size_t p = top_(from);
+    return p == PETKIT_PRIO_COUNT ? nullptr : &rings_[p].front();
+  }
+  void pop(PetkitTxPrio from = PETKIT_PRIO_CONTROL) {
+    const size_t p = top_(from);
+    if (p != PETKIT_PRIO_COUNT) rings_[p].pop();
+  }
+
+  bool contains(PetkitTxPrio prio, uint8_t cmd) const { return rings_[prio].contains(cmd); }
+
+  void clear() {
+    for (auto &r : rings_) r.clear();
+  }
+
+ protected:
+  size_t top_(PetkitTxPrio from) const {
+    for (size_t p = from; p < PETKIT_PRIO_COUNT; p++)
+      if (!rings_[p].empty()) return p;
+    return PETKIT_PRIO_COUNT;
+  }
+
+  std::array<PetkitTxRing<N>, PETKIT_PRIO_COUNT> rings_{};
+};
+
+// ---------------- In-flight commands ----------------
+// A sent command waiting for its reply, keyed by the seq byte it went out with.
+struct PetkitInflight {
+  PetkitPendingCmd cmd;
+  uint8_t seq{0};
+  uint8_t attempts{0};  // sends so far
+  bool used{false};
+  uint32_t deadline_ms{0};
+  uint32_t sent_ms{0};  // last send, for round-trip metrics
+};
+
+template<size_t N> class PetkitInflightTable {
+ public:
+  bool empty() const { return count_ == 0; }
+  bool full() const { return count_ == N; }
+  size_t size() const { return count_; }
+  static constexpr size_t capacity() { return N; }
+
+  PetkitInflight *add(const PetkitPendingCmd &cmd, uint8_t seq, uint32_t deadline_ms) {
+    for (auto &e : items_) {
+      if (e.used) continue;
+      e.cmd = cmd;
+      e.seq = seq;
+      e.attempts = 1;
+      e.deadline_ms = deadline_ms;
+      e.used = true;
+      count_++;
+      return &e;
+    }
+    return nullptr;
+  }
+
+  PetkitInflight *find_seq(uint8_t seq) {
+    for (auto &e : items_)
+      if (e.used && e.seq == seq) return &e;
+    return nullptr;
+  }
+
+  bool contains(uint8_t cmd) const {
+    for (const auto &e : items_)
+      if (e.used && e.cmd.cmd == cmd) return true;
+    return false;
+  }
+
+  // Oldest (earliest deadline) entry for cmd.
+  PetkitInflight *find_cmd(uint8_t cmd) {
+    PetkitInflight *best = nullptr;
+    for (auto &e : items_) {
+      if (!e.used || e.cmd.cmd != cmd) continue;
+      if (best == nullptr || (int32_t) (e.deadline_ms - best->deadline_ms) < 0) best = &e;
+    }
+    return best;
+  }
+
+  // Reply lookup: exact seq first, then by cmd for firmwares that don't echo seq.
+  PetkitInflight *match(uint8_t seq, uint8_t cmd) {
+    PetkitInflight *e = find_seq(seq);
+    if (e != nullptr && e->cmd.cmd == cmd) return e;
+    return find_cmd(cmd);
+  }
+
+  PetkitInflight *expired(uint32_t now_ms) {
+    for (auto &e : items_)
+      if (e.used && (int32_t) (now_ms - e.deadline_ms) >= 0) return &e;
+    return nullptr;
+  }
+
+  void release(PetkitInflight &e) {
+    if (!e.used) return;
+    e.used = false;
+    count_--;
+  }
+
+  void clear() {
+    for (auto &e : items_) e.used = false;
+    count_ = 0;
+  }
+
+ protected:
+  std::array<PetkitInflight, N> items_{};
+  size_t count_{0};
+};
+
+// ---------------- Link metrics ----------------
+// Round-trip histogram: bucket i counts replies faster than 16 << i ms, the last bucket the rest.
+struct PetkitLatencyHist {
+  static constexpr size_t BUCKETS = 8;
+  static constexpr uint32_t bucket_limit(size_t i) { return 16u << i; }
+
+  std::array<uint16_t, BUCKETS> counts{};
+  uint32_t n{0};
+  uint32_t sum_ms{0};
+  uint32_t max_ms{0};
+
+  void add(uint32_t ms) {
+    size_t i = 0;
+    while (i + 1 < BUCKETS && ms >= bucket_limit(i)) i++;
+    if (counts[i] != UINT16_MAX) counts[i]++;
+    n++;
+    sum_ms += ms;
+    max_ms = std::max(max_ms, ms);
+  }
+
+  uint32_t mean() const { return n == 0 ? 0 : sum_ms / n; }
+
+  // Upper bound of the bucket holding fraction p (0..1) of the samples; max for the last bucket.
+  uint32_t percentile(float p) const {
+    uint32_t total = 0;
+    for (auto c : counts) total += c;
+    if (total == 0) return 0;
+    uint32_t want = (uint32_t) (p * total + 0.999f);
+    if (want == 0) want = 1;
+    uint32_t acc = 0;
+    for (size_t i = 0; i + 1 < BUCKETS; i++) {
+      acc += counts[i];
+      if (acc >= want) return std::min(bucket_limit(i), max_ms);
+    }
+    return max_ms;
+  }
+};
+
+// Counters for one link. Per-command stats (keyed by command byte; a reply shares it with
+// its request) live in a few slots allocated on first use; unhandled commands get a full
+// 256-entry histogram since their bytes are unknown upfront.
+class PetkitLinkMetrics {
+ public:
+  static constexpr size_t CMD_SLOTS = 12;
+
+  struct CmdStats {
+    uint8_t cmd{0};
+    bool used{false};
+    uint16_t parse_errors{0};
+    uint16_t timeouts{0};
+    PetkitLatencyHist rtt;
+  };
+
+  uint32_t tx_frames{0};
+  uint32_t rx_frames{0};
+  uint32_t retries{0};
+  uint32_t timeouts{0};
+  uint32_t parse_errors{0};  // invalid frames + frames a handler rejected
+  uint32_t unhandled{0};
+  uint8_t queue_high_water{0};
+  uint32_t first_state_ms{0};  // connect -> first state in the last session (0 = none yet)
+
+  void on_invalid_frame() { parse_errors++; }
+  void on_parse_error(uint8_t cmd) {
+    parse_errors++;
+    if (CmdStats *c = slot_(cmd)) c->parse_errors++;
+  }
+  void on_unhandled(uint8_t cmd) {
+    unhandled++;
+    if (unhandled_[cmd] != UINT16_MAX) unhandled_[cmd]++;
+  }
+  void on_reply(uint8_t cmd, uint32_t rtt_ms) {
+    rtt_.add(rtt_ms);
+    if (CmdStats *c = slot_(cmd)) c->rtt.add(rtt_ms);
+  }
+  void on_timeout(uint8_t cmd) {
+    timeouts++;
+    if (CmdStats *c = slot_(cmd)) c->timeouts++;
+  }
+  void on_queue_depth(size_t depth) {
+    if (depth > queue_high_water) queue_high_water = (uint8_t) std::min<size_t>(depth, 0xFF);
+  }
+
+  const PetkitLatencyHist &rtt() const { return rtt_; }
+  uint16_t unhandled_count(uint8_t cmd) const { return unhandled_[cmd]; }
+  template<typename F> void for_each_cmd(F &&fn) const {
+    for (const auto &c : cmds_)
+      if (c.used) fn(c);
+  }
+
+  // Compact one-line summary (fits a 255-char text sensor):
+  //   tx=.. rx=.. rt=.. to=.. pe=.. uh=.. hw=.. fs=..ms rtt=p50/p90/max cmd:n@p50/p90 .. ?cmd*n ..
+  size_t format(char *out, size_t cap) const {
+    if (cap == 0) return 0;
+    size_t pos = 0;
+    auto put = [&](const char *fmt, auto... args) {
+      if (pos >= cap) return;
+      int n = snprintf(out + pos, cap - pos, fmt, args...);
+      if (n > 0) pos = std::min(cap - 1, pos + (size_t) n);
+    };
+    put("tx=%u rx=%u rt=%u to=%u pe=%u uh=%u hw=%u fs=%ums rtt=%u/%u/%u", (unsigned) tx_frames,
+        (unsigned) rx_frames, (unsigned) retries, (unsigned) timeouts, (unsigned) parse_errors, (unsigned) unhandled,
+        (unsigned) queue_high_water, (unsigned) first_state_ms, (unsigned) rtt_.percentile(0.5f),
+        (unsigned) rtt_.percentile(0.9f), (unsigned) rtt_.max_ms);
+    for (const auto &c : cmds_) {
+      if (!c.used || c.rtt.n == 0) continue;
+      put(" %u:%u@%u/%u", (unsigned) c.cmd, (unsigned) c.rtt.n, (unsigned) c.rtt.percentile(0.5f),
+          (unsigned) c.rtt.percentile(0.9f));
+    }
+    for (size_t i = 0; i < unhandled_.size(); i++) {
+      if (unhandled_[i] != 0) put(" ?%02X*%u", (unsigned) i, (unsigned) unhandled_[i]);
+    }
+    return pos;
+  }
+
+  void reset() { *this = PetkitLinkMetrics(); }
+
+ protected:
+  CmdStats *slot_(uint8_t cmd) {
+    for (auto &c : cmds_)
+      if (c.used && c.cmd == cmd) return &c;
+    for (auto &c : cmds_) {
+      if (c.used) continue;
+      c.used = true;
+      c.cmd = cmd;
+      return &c;
+    }
+    return nullptr;  // all slots taken; totals still count
+  }
+
+  std::array<CmdStats, CMD_SLOTS> cmds_{};
+  std::array<uint16_t, 256> unhandled_{};
+  PetkitLatencyHist rtt_;
+};
+
+// ---------------- Heap probe ----------------
+// Allocations made by the RX/TX handlers. The counts come from an allocator hook that only
+// counts the calling task (petkit_alloc_probe.cpp on the device, operator new in the host
+// test), so transient allocations freed inside the handler are seen and other tasks add no
+// noise. The free heap is still sampled for the low-water marks.
+struct PetkitAllocCount {  // running totals of the probed task
+  uint32_t allocs{0};
+  uint32_t bytes{0};
+};
+
+struct PetkitHeapStats {
+  struct Side {
+    uint32_t calls{0};
+    uint32_t allocs{0};  // allocations made inside the handler, freed or not
+    uint32_t bytes{0};   // bytes they requested
+  };
+  Side rx;  // per reassembled RX frame
+  Side tx;  // per GATT write
+
+  // lowest values seen after a handler since the last take_low()
+  uint32_t low_free{UINT32_MAX};
+  uint32_t low_largest{UINT32_MAX};
+
+  // Returns the allocations the call made (totals wrap, so differences stay exact).
+  static uint32_t account(Side &side, const PetkitAllocCount &before, const PetkitAllocCount &after) {
+    side.calls++;
+    const uint32_t n = after.allocs - before.allocs;
+    side.allocs += n;
+    side.bytes += after.bytes - before.bytes;
+    return n;
+  }
+  void sample_free(size_t free) { low_free = std::min<uint32_t>(low_free, uint32_t(free)); }
+  void sample_largest(size_t largest) { low_largest = std::min<uint32_t>(low_largest, uint32_t(largest)); }
+  // Lows for publishing; they restart from the given current values.
+  void take_low(size_t free, size_t largest, uint32_t &out_free, uint32_t &out_largest) {
+    sample_free(free);
+    sample_largest(largest);
+    out_free = low_free;
+    out_largest = low_largest;
+    low_free = uint32_t(free);
+    low_largest = uint32_t(largest);
+  }
+};
+
+// ---------------- Packet capture ----------------
+// Binary ring of recent RX/TX frames for on-demand export. Recording is a bounded copy
+// into preallocated storage; nothing is formatted until the ring is dumped.
+static constexpr size_t PETKIT_CAPTURE_SLOT = 48;  // bytes kept per frame (E6 is 38..42+)
+
+enum PetkitCaptureDir : uint8_t { PETKIT_CAPTURE_RX = 0, PETKIT_CAPTURE_TX = 1 };
+
+struct PetkitCaptureRecord {
+  uint32_t ms{0};
+  uint8_t dir{PETKIT_CAPTURE_RX};
+  uint8_t seq{0};
+  uint8_t len{0};         // original frame length (saturated at 255)
+  uint8_t stored_len{0};  // bytes kept in `bytes`, <= PETKIT_CAPTURE_SLOT
+  std::array<uint8_t, PETKIT_CAPTURE_SLOT> bytes{};
+};
+// Ring sizes, mirrored in sensor.py: the default is on in every build (~0.9 KB), the
+// maximum keeps the ring near 7 KB so it fits next to the BLE stack on an ESP32-C3.
+static constexpr uint16_t PETKIT_CAPTURE_DEFAULT = 16;
+static constexpr uint16_t PETKIT_CAPTURE_MAX = 128;
+static_assert(sizeof(PetkitCaptureRecord) <= 56, "capture record grew, recheck PETKIT_CAPTURE_MAX");
+
+class PetkitCapture {
+ public:
+  // `storage` must hold `capacity` records and outlive the capture.
+  void init(PetkitCaptureRecord *storage, size_t capacity) {
+    records_ = storage;
+    capacity_ = capacity;
+    head_ = count_ = 0;
+  }
+
+  bool enabled() const { return capacity_ != 0; }
+  size_t size() const { return count_; }
+  uint32_t get_total() const { return total_; }
+
+  void record(uint32_t now_ms, PetkitCaptureDir dir, const uint8_t *frame, size_t len) {
+    if (capacity_ == 0) return;
+    PetkitCaptureRecord &r = records_[(head_ + count_) % capacity_];
+    if (count_ < capacity_) {
+      count_++;
+    } else {
+      head_ = (head_ + 1) % capacity_;  // overwrite oldest
+    }
+    r.ms = now_ms;
+    r.dir = dir;
+    r.seq = len > PETKIT_SEQ_OFFSET ? frame[PETKIT_SEQ_OFFSET] : 0;
+    r.len = len > 0xFF ? 0xFF : (uint8_t) len;
+    r.stored_len = (uint8_t) std::min(len, PETKIT_CAPTURE_SLOT);
+    std::copy(frame, frame + r.stored_len, r.bytes.begin());
+    total_++;
+  }
+
+  // Visits records oldest first.
+  template<typename F> void for_each(F &&fn) const {
+    for (size_t i = 0; i < count_; i++) fn(records_[(head_ + i) % capacity_]);
+  }
+
+  void clear() { head_ = count_ = 0; }
+
+ protected:
+  PetkitCaptureRecord *records_{nullptr};
+  size_t capacity_{0};
+  size_t head_{0};
+  size_t count_{0};
+  uint32_t total_{0};
+};
+
+// Export line for one record, decoded by host tools:
+//   PKCAP1 <ms> <R|T> <seq> <len> <hex of stored bytes>
+// Returns the number of characters written (excluding the terminator).
+static inline size_t petkit_format_capture_(const PetkitCaptureRecord &r, char *out, size_t cap) {
+  static const char *HEX = "0123456789ABCDEF";
+  int n = snprintf(out, cap, "PKCAP1 %u %c %u %u ", (unsigned) r.ms, r.dir == PETKIT_CAPTURE_TX ? 'T' : 'R',
+                   (unsigned) r.seq, (unsigned) r.len);
+  if (n < 0) return 0;
+  size_t pos = (size_t) n;
+  for (size_t i = 0; i < r.stored_len && pos + 2 < cap; i++) {
+    out[pos++] = HEX[(r.bytes[i] >> 4) & 0xF];
+    out[pos++] = HEX[r.bytes[i] & 0xF];
+  }
+  if (pos < cap) out[pos] = '\0';
+  return pos;
+}
+
+// Longest export line: header + 2 hex chars per stored byte + terminator.
+static constexpr size_t PETKIT_CAPTURE_LINE_MAX = 40 + 2 * PETKIT_CAPTURE_SLOT + 1;
+
+// device_id8 = device id padded left with zeros to 8 bytes
+// secret     = reverse(device id) + replace last two if zero + pad left to 8
+static inline void petkit_compute_secret_(const PetkitDeviceId &device_id, std::array<uint8_t, 8> &device_id8,
+                                          std::array<uint8_t, 8> &secret) {
+  constexpr size_t n = PETKIT_DEVICE_ID_LEN;
+  device_id8.fill(0);
+  std::copy(device_id.begin(), device_id.end(), device_id8.begin() + (8 - n));
+
+  PetkitDeviceId tmp = device_id;
+  std::reverse(tmp.begin(), tmp.end());
+  if (tmp[n - 1] == 0 && tmp[n - 2] == 0) {
+    tmp[n - 2] = 13;
+    tmp[n - 1] = 37;
+  }
+
+  secret.fill(0);
+  std::copy(tmp.begin(), tmp.end(), secret.begin() + (8 - n));
+}
+
+}  // namespace petkit_fountain
+}  // namespace esphome
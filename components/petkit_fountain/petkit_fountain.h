@@ -10,93 +10,135 @@
 #include "esphome/components/text_sensor/text_sensor.h"
 #include "esphome/components/binary_sensor/binary_sensor.h"
 
-#include <deque>
+#include "petkit_codec.h"
+
+#include <initializer_list>
+#include <memory>
 #include <vector>
 #include <string>
 #include <cmath>
 #include <ctime>
 #include <cctype>
 #include <cstdint>
-#include <string>
-#include <vector>
 #include <array>
 #include <algorithm>
 #include <esp_gattc_api.h>
+#include <esp_gap_ble_api.h>
+#include <esp_heap_caps.h>
 
 namespace esphome {
 namespace petkit_fountain {
 
-struct Petkit213Info {
-  bool ok{false};
-  uint8_t cmd{0};
-  uint8_t type{0};
-  uint8_t seq{0};
-  uint8_t data_len{0};
+class PetkitFountain;
 
-  std::vector<uint8_t> device_id_bytes;  // 6 bytes (data[2:8])
-  uint64_t device_id_int{0};             // big endian from those 6 bytes
-  std::string serial;                    // printable ASCII run
+#ifdef USE_PETKIT_ALLOC_PROBE
+// Allocator hook (petkit_alloc_probe.cpp, malloc/calloc/realloc wrapped at link time): counting
+// moves to the calling task and its running totals are returned.
+PetkitAllocCount petkit_alloc_probe_begin();
+PetkitAllocCount petkit_alloc_probe_totals();
+#endif
+
+// D2/E6 frame layout, fixed per build. Codegen defines PETKIT_MODEL_PROFILE when the model is
+// pinned; only the auto profile compiles the length probing and the layout report.
+#ifdef PETKIT_MODEL_PROFILE
+using PetkitModelProfile = PETKIT_MODEL_PROFILE;
+#else
+using PetkitModelProfile = PetkitProfileAuto;
+#endif
+
+// Every value the component publishes. Entities are bound to a field (see PetkitBinding),
+// the last published value per field is cached by the component.
+enum PetkitField : uint8_t {
+  FIELD_POWER,
+  FIELD_MODE,
+  FIELD_NIGHT_DND,
+  FIELD_BREAKDOWN_WARN,
+  FIELD_LACK_WARN,
+  FIELD_FILTER_WARN,
+  FIELD_FILTER_PERCENT,
+  FIELD_RUN_STATUS,
+  FIELD_PUMP_RUNTIME,
+  FIELD_TODAY_PUMP_RUNTIME,
+  FIELD_TODAY_PURIFIED,
+  FIELD_TODAY_ENERGY,
+  FIELD_SMART_ON,
+  FIELD_SMART_OFF,
+  FIELD_LIGHT_SW,
+  FIELD_BRIGHTNESS,
+  FIELD_LIGHT_START,
+  FIELD_LIGHT_END,
+  FIELD_DND_SW,
+  FIELD_DND_START,
+  FIELD_DND_END,
+  FIELD_FILTER_REMAINING_DAYS,
+  FIELD_FILTER_DAYS_LOW,
+  FIELD_FILTER_DAYS_HIGH,
+  FIELD_TX_QUEUE_DEPTH,
+  FIELD_TX_DROPPED,
+  FIELD_CONNECTED_FRACTION,
+  FIELD_TOTAL_PUMP_RUNTIME,
+  FIELD_TOTAL_PURIFIED,
+  FIELD_TOTAL_ENERGY,
+  FIELD_DAILY_PUMP_RUNTIME,
+  FIELD_DAILY_PURIFIED,
+  FIELD_DAILY_ENERGY,
+  FIELD_TX_FRAMES,
+  FIELD_RX_FRAMES,
+  FIELD_RETRIES,
+  FIELD_REPLY_TIMEOUTS,
+  FIELD_PARSE_ERRORS,
+  FIELD_UNHANDLED_FRAMES,
+  FIELD_TX_QUEUE_HIGH_WATER,
+  FIELD_FIRST_STATE_LATENCY,
+  FIELD_REPLY_LATENCY,
+  FIELD_HEAP_FREE,
+  FIELD_HEAP_LARGEST_BLOCK,
+  FIELD_RX_HEAP_ALLOCS,
+  FIELD_RX_HEAP_BYTES,
+  FIELD_TX_HEAP_ALLOCS,
+  FIELD_TX_HEAP_BYTES,
+  FIELD_COUNT,
 };
 
-static inline bool petkit_is_printable_ascii_(uint8_t b) {
-  return (b >= 0x20 && b <= 0x7E);
-}
-
-static Petkit213Info petkit_parse_cmd213_(const uint8_t *frame, size_t len) {
-  Petkit213Info out;
-
-  // Minimum: 3 header + cmd/type/seq/len/start + end = 9 bytes
-  if (len < 9) return out;
-
-  if (frame[0] != 0xFA || frame[1] != 0xFC || frame[2] != 0xFD) return out;
-  if (frame[len - 1] != 0xFB) return out;
-
-  out.cmd = frame[3];
-  out.type = frame[4];
-  out.seq = frame[5];
-  out.data_len = frame[6];
-  // uint8_t data_start = frame[7]; // expected 0; not strictly required
-
-  // Expected total frame length: 9 + data_len
-  if (len != static_cast<size_t>(9 + out.data_len)) return out;
-  if (out.cmd != 0xD5) return out;  // 213
-
-  const uint8_t *data = frame + 8;
-  const size_t dlen = out.data_len;
-
-  // Python does: device_id_bytes = data[2:8] (6 bytes)
-  if (dlen < 8) return out;
-  out.device_id_bytes.assign(data + 2, data + 8);
-
-  out.device_id_int = 0;
-  for (auto b : out.device_id_bytes) out.device_id_int = (out.device_id_int << 8) | (uint64_t) b;
+// How a bound entity takes its field's value.
+enum PetkitBindKind : uint8_t { BIND_SENSOR, BIND_BINARY_SENSOR, BIND_SWITCH, BIND_NUMBER, BIND_MODE_SELECT };
 
-  // Extract longest printable ASCII run (serial sits at tail for CTW2)
-  size_t best_start = 0, best_len = 0;
-  size_t cur_start = 0, cur_len = 0;
-
-  for (size_t i = 0; i < dlen; i++) {
-    if (petkit_is_printable_ascii_(data[i])) {
-      if (cur_len == 0) cur_start = i;
-      cur_len++;
-      if (cur_len > best_len) {
-        best_len = cur_len;
-        best_start = cur_start;
-      }
-    } else {
-      cur_len = 0;
-    }
-  }
-
-  if (best_len >= 6) {
-    out.serial.assign(reinterpret_cast<const char *>(data + best_start), best_len);
-  }
-
-  out.ok = true;
-  return out;
-}
+struct PetkitBinding {
+  union {
+    sensor::Sensor *sensor;
+    binary_sensor::BinarySensor *binary_sensor;
+    switch_::Switch *sw;
+    number::Number *number;
+    select::Select *select;
+  };
+  float last;  // last value published to this entity, see publish_field_()
+  PetkitField field;
+  PetkitBindKind kind;
+  bool valid;  // `last` holds a published value
+};
 
-class PetkitFountain;
+// Registry capacity. Codegen defines PETKIT_MAX_BINDINGS as the most entities any fountain
+// in the build binds; unset (host builds) every field may have one entity.
+#ifdef PETKIT_MAX_BINDINGS
+static constexpr size_t PETKIT_BINDING_CAPACITY = PETKIT_MAX_BINDINGS;
+#else
+static constexpr size_t PETKIT_BINDING_CAPACITY = FIELD_COUNT;
+#endif
+static_assert(PETKIT_BINDING_CAPACITY >= 1 && PETKIT_BINDING_CAPACITY <= 255, "binding_count_ is 8-bit");
+
+// RX dispatch entry, one per command byte. Frames are only handed to `handler` after the
+// front end checked the type (unless PETKIT_ANY_TYPE) and data_len within [min_len, max_len].
+static constexpr uint8_t PETKIT_ANY_TYPE = 0xFF;
+
+struct PetkitCmdEntry {
+  void (PetkitFountain::*handler)(const PetkitFrame &){nullptr};
+  const char *name{nullptr};
+  uint8_t type{PETKIT_ANY_TYPE};
+  uint8_t min_len{0};
+  uint8_t max_len{0xFF};
+  // Called when the request sharing this cmd byte is answered (true) or runs out of retries (false).
+  void (PetkitFountain::*on_done)(const PetkitInflight &, bool){nullptr};
+};
 
 // ---------------- Switch entities ----------------
 class PetkitBaseSwitch : public switch_::Switch {
@@ -175,7 +217,7 @@ class PetkitModeSelect : public select::Select {
 // ---------------- Button entity ----------------
 class PetkitActionButton : public button::Button {
  public:
-  enum Action { REFRESH, READ_CONFIG, RESET_FILTER, SET_DATETIME, INIT_SESSION, SYNC };
+  enum Action { REFRESH, READ_CONFIG, RESET_FILTER, SET_DATETIME, INIT_SESSION, SYNC, DUMP_CAPTURE };
   void set_parent(PetkitFountain *p) { parent_ = p; }
   void set_action(Action a) { action_ = a; }
   void set_action(int a) { action_ = (Action) a; }
@@ -197,75 +239,130 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
         notify_uuid_(esp32_ble::ESPBTUUID::from_raw(notify_uuid)),
         write_uuid_(esp32_ble::ESPBTUUID::from_raw(write_uuid)) {}
 
-  // sensor setters
-  void set_power_sensor(sensor::Sensor *s) { power_ = s; }
-  void set_mode_sensor(sensor::Sensor *s) { mode_ = s; }
-  void set_is_night_dnd_sensor(sensor::Sensor *s) { is_night_dnd_ = s; }
-  void set_filter_percent_sensor(sensor::Sensor *s) { filter_percent_ = s; }
-  void set_run_status_sensor(sensor::Sensor *s) { run_status_ = s; }
-  
-  void set_water_pump_runtime_seconds_sensor(sensor::Sensor *s) { water_pump_runtime_seconds_ = s; }
-  void set_today_pump_runtime_seconds_sensor(sensor::Sensor *s) { today_pump_runtime_seconds_ = s; }
-  void set_today_purified_water_times_sensor(sensor::Sensor *s) { today_purified_water_times_ = s; }
-  void set_today_energy_kwh_sensor(sensor::Sensor *s) { today_energy_kwh_ = s; }
-  
-  void set_smart_working_time_sensor(sensor::Sensor *s) { smart_working_time_ = s; }
-  void set_smart_sleep_time_sensor(sensor::Sensor *s) { smart_sleep_time_ = s; }
-  
-  void set_light_switch_sensor(sensor::Sensor *s) { light_switch_ = s; }
-  void set_light_brightness_sensor(sensor::Sensor *s) { light_brightness_ = s; }
-  void set_light_schedule_start_min_sensor(sensor::Sensor *s) { light_schedule_start_min_ = s; }
-  void set_light_schedule_end_min_sensor(sensor::Sensor *s) { light_schedule_end_min_ = s; }
-  
-  void set_dnd_switch_sensor(sensor::Sensor *s) { dnd_switch_ = s; }
-  void set_dnd_start_min_sensor(sensor::Sensor *s) { dnd_start_min_ = s; }
-  void set_dnd_end_min_sensor(sensor::Sensor *s) { dnd_end_min_ = s; }
-  void set_filter_remaining_days_sensor(sensor::Sensor *s) { filter_remaining_days_ = s; }
-
-  // binary sensor setters
-  void set_lack_warning_binary_sensor(binary_sensor::BinarySensor *s) { lack_warning_bin_ = s; }
-  void set_breakdown_warning_binary_sensor(binary_sensor::BinarySensor *s) { breakdown_warning_bin_ = s; }
-  void set_filter_warning_binary_sensor(binary_sensor::BinarySensor *s) { filter_warning_bin_ = s; }
-
-
-  // number setters
-  void set_light_start_number(number::Number *n) { light_start_num_ = n; }
-  void set_light_end_number(number::Number *n) { light_end_num_ = n; }
-  void set_dnd_start_number(number::Number *n) { dnd_start_num_ = n; }
-  void set_dnd_end_number(number::Number *n) { dnd_end_num_ = n; }
-  void set_smart_on_number(PetkitSmartOnNumber *n) { smart_on_num_ = n; n->set_parent(this); }
-  void set_smart_off_number(PetkitSmartOffNumber *n) { smart_off_num_ = n; n->set_parent(this); }
-  
-  // text sensor setter
-  void set_serial_text_sensor(text_sensor::TextSensor *t) { serial_text_ = t; }
+  // entity bindings, emitted by codegen only for configured entities
+  void bind_sensor(PetkitField f, sensor::Sensor *s) {
+    PetkitBinding b{};
+    b.sensor = s;
+    add_binding_(b, f, BIND_SENSOR);
+  }
+  void bind_binary_sensor(PetkitField f, binary_sensor::BinarySensor *s) {
+    PetkitBinding b{};
+    b.binary_sensor = s;
+    add_binding_(b, f, BIND_BINARY_SENSOR);
+  }
+  void bind_switch(PetkitField f, PetkitBaseSwitch *s) {
+    s->set_parent(this);
+    PetkitBinding b{};
+    b.sw = s;
+    add_binding_(b, f, BIND_SWITCH);
+  }
+  void bind_number(PetkitField f, PetkitBaseNumber *n) {
+    n->set_parent(this);
+    PetkitBinding b{};
+    b.number = n;
+    add_binding_(b, f, BIND_NUMBER);
+  }
+  void bind_mode_select(PetkitModeSelect *s) {
+    s->set_parent(this);
+    PetkitBinding b{};
+    b.select = s;
+    add_binding_(b, FIELD_MODE, BIND_MODE_SELECT);
+  }
 
-  // entity attachers
-  void set_light_switch(PetkitLightSwitch *s) { light_sw_ = s; s->set_parent(this); }
-  void set_dnd_switch(PetkitDndSwitch *s) { dnd_sw_ = s; s->set_parent(this); }
-  void set_power_switch(PetkitPowerSwitch *s) { power_sw_ = s; s->set_parent(this); }
+  void set_energy_scale(float kwh_per_count) { energy_scale_ = kwh_per_count; }
 
-  void set_brightness_number(PetkitBrightnessNumber *n) { brightness_num_ = n; n->set_parent(this); }
-  void set_time_number(PetkitTimeNumber *n) { time_nums_.push_back(n); n->set_parent(this); }
+  // learned filter life (see PetkitFilterEstimator)
+  void set_filter_replacement_date_text_sensor(text_sensor::TextSensor *t) { filter_replacement_text_ = t; }
 
-  void set_mode_select(PetkitModeSelect *s) { mode_sel_ = s; s->set_parent(this); }
+  // frame layout is fixed per build, see PetkitModelProfile
+  void set_model_profile_text_sensor(text_sensor::TextSensor *t) { profile_text_ = t; }
 
+  // text sensors
+  void set_serial_text_sensor(text_sensor::TextSensor *t) { serial_text_ = t; }
+  void set_link_summary_text_sensor(text_sensor::TextSensor *t) { link_summary_text_ = t; }
+
+  // buttons
   void set_action_button(PetkitActionButton *b) { buttons_.push_back(b); b->set_parent(this); }
 
+  // publish cache
+  void set_full_republish_interval(uint32_t ms) { full_republish_interval_ms_ = ms; }
+  void set_republish_on_reconnect(bool b) { republish_on_reconnect_ = b; }
+
+  void set_packet_capture_size(uint16_t n) { capture_size_ = std::min(n, PETKIT_CAPTURE_MAX); }
+
+  void set_write_without_response(bool b) { write_no_rsp_ = b; }
+
+  void set_config_coalesce_window(uint32_t ms) { config_coalesce_ms_ = ms; }
+
+  // duty cycle: connect every interval for one session, then disconnect (0 = stay connected)
+  void set_duty_cycle_interval(uint32_t ms) { duty_interval_ms_ = ms; }
+  void set_duty_cycle_session_timeout(uint32_t ms) { duty_session_timeout_ms_ = ms; }
+  // adaptive polling: update_interval is the fast rate, see poll_interval_()
+  void set_poll_idle_interval(uint32_t ms) { poll_idle_ms_ = ms; }
+  void set_poll_dnd_interval(uint32_t ms) { poll_dnd_ms_ = ms; }
+  void set_poll_airtime_budget(float fraction) { poll_budget_ = fraction; }
+  // connection is scheduled by PetkitFountainManager; duty cycling is off
+  void set_managed(bool b) { managed_ = b; }
+
   void setup() override {
-    ESP_LOGI(TAG, "setup");
+    ESP_LOGI(TAG, "setup (model profile: %s, %u entities)", PetkitModelProfile::NAME, (unsigned) binding_count_);
+    // entity lists are complete once codegen ran; nothing below allocates again
+    buttons_.shrink_to_fit();
+    heap_probe_ = (bound_mask_ & HEAP_FIELDS) != 0;
+    if (profile_text_) profile_text_->publish_state(PetkitModelProfile::NAME);
+    if (capture_size_ > 0) {
+      // one-time allocation; recording afterwards only copies into this storage
+      capture_storage_.reset(new PetkitCaptureRecord[capture_size_]);
+      capture_.init(capture_storage_.get(), capture_size_);
+    }
+    if (this->parent()) {
+      load_identity_cache_(this->parent()->get_address());
+      load_config_cache_(this->parent()->get_address());
+      load_usage_(this->parent()->get_address());
+      load_filter_estimate_(this->parent()->get_address());
+    }
+    if (duty_cycling_()) {
+      auto *client = this->parent();
+      if (client) client->set_enabled(false);
+      duty_next_ms_ = millis();
+    }
   }
 
   void update() override {
-    // optional periodic refresh
-    // cmd_refresh_();
+    poll_step_();
+    ESP_LOGV(TAG, "RX framer: frames=%u reassembled=%u dropped=%u garbage=%u", (unsigned) framer_.get_frames(),
+             (unsigned) framer_.get_reassembled(), (unsigned) framer_.get_dropped(),
+             (unsigned) framer_.get_garbage_bytes());
+    ESP_LOGV(TAG, "TX queue: depth=%u in_flight=%u dropped=%u collapsed=%u", (unsigned) txq_.size(),
+             (unsigned) inflight_.size(), (unsigned) tx_dropped_, (unsigned) tx_collapsed_);
+    publish_field_(FIELD_TX_QUEUE_DEPTH, (float) txq_.size());
+    publish_field_(FIELD_TX_DROPPED, (float) tx_dropped_);
+    if (is_bound_(FIELD_CONNECTED_FRACTION)) {
+      const uint32_t now = millis();
+      const uint32_t up = link_up_total_ms_ + (link_up_ ? now - link_up_since_ms_ : 0);
+      publish_field_(FIELD_CONNECTED_FRACTION, now == 0 ? 0.0f : std::round(1000.0f * up / now) / 10.0f);
+    }
+    publish_metrics_();
+    if (heap_probe_) publish_heap_();
+    if (usage_.roll_day(local_day_key_())) save_usage_(true);
+    publish_usage_();
   }
 
   void loop() override {
+    if (duty_cycling_()) duty_cycle_step_();
+    if (cfg_staged_mask_ != 0 && (int32_t) (millis() - cfg_flush_at_ms_) >= 0) flush_config_();
+    if (cfg_save_pending_) save_config_cache_();
+    if (usage_save_pending_) save_usage_(false);
+    if (filter_save_pending_) save_filter_estimate_();
     process_tx_queue_();
+    if (full_republish_interval_ms_ != 0 && (millis() - last_full_republish_ms_) >= full_republish_interval_ms_) {
+      last_full_republish_ms_ = millis();
+      republish_all_();
+    }
     // Auto-init: send CMD213 once after notify is ready
     if (this->notify_ready_ && !this->auto_213_sent_ && millis() > this->auto_213_at_ms_) {
       // enqueue cmd=213 type=1 seq=... data=[0,0]
-      this->enqueue_(213, 1, {0x00, 0x00});
+      this->enqueue_read_(213);
       this->auto_213_sent_ = true;
       ESP_LOGD(TAG, "Auto TX: CMD213 requested");
     }
@@ -273,72 +370,25 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
       this->schedule_cmd210_ = false;
   
       // CMD210: type=1, data=[0,0]
-      this->enqueue_(210, 1, {0x00, 0x00});
+      this->enqueue_read_(210);
   
       this->cmd210_sent_after_213_ = true;
       ESP_LOGD(TAG, "TX scheduled CMD210 fired");
     }
     if (this->init_stage_ != INIT_NONE && (int32_t)(millis() - this->init_at_ms_) >= 0) {
-      switch (this->init_stage_) {
-        case INIT_SEND_73: {
-          // CMD73 payload: [0,0] + device_id(8) + secret(8)
-          std::vector<uint8_t> payload;
-          payload.reserve(2 + 8 + 8);
-          payload.push_back(0x00);
-          payload.push_back(0x00);
-          payload.insert(payload.end(), device_id8_.begin(), device_id8_.end());
-          payload.insert(payload.end(), secret_.begin(), secret_.end());
-    
-          this->enqueue_(73, 1, payload);
-          ESP_LOGD(TAG, "Init chain: sent CMD73");
-          this->init_stage_ = INIT_SEND_86;
-          this->init_at_ms_ = millis() + 1500;
-          break;
-        }
-    
-        case INIT_SEND_86: {
-          // CMD86 payload: [0,0] + secret(8)
-          std::vector<uint8_t> payload;
-          payload.reserve(2 + 8);
-          payload.push_back(0x00);
-          payload.push_back(0x00);
-          payload.insert(payload.end(), secret_.begin(), secret_.end());
-    
-          this->enqueue_(86, 1, payload);
-          ESP_LOGD(TAG, "Init chain: sent CMD86");
-          this->init_stage_ = INIT_SEND_84;
-          this->init_at_ms_ = millis() + 750;
-          break;
-        }
-    
-        case INIT_SEND_84: {
-          // CMD84 payload: Utils.time_in_bytes() equivalent: [0, sec>>24, sec>>16, sec>>8, sec, 13]
-          // Reference time: 2000-01-01 UTC. If you already implemented time bytes, call that.
-          auto t = this->build_time_bytes_();  // <-- implement or reuse existing
-          this->enqueue_(84, 1, t);
-          ESP_LOGD(TAG, "Init chain: sent CMD84");
-          this->init_stage_ = INIT_SEND_210;
-          this->init_at_ms_ = millis() + 750;
-          break;
-        }
-    
-        case INIT_SEND_210: {
-          this->enqueue_(210, 1, {0x00, 0x00});
-          ESP_LOGD(TAG, "Init chain: sent CMD210");
-          this->init_stage_ = INIT_SEND_211;
-          break;
-        }
-    
-        case INIT_SEND_211: {
-          this->enqueue_(211, 1, {0x00, 0x00});
-          ESP_LOGD(TAG, "Init chain: sent CMD211");
-          this->init_stage_ = INIT_NONE;
-          break;
+      if (this->init_wait_ack_ != 0 && this->inflight_.find_cmd(this->init_wait_ack_) != nullptr) {
+        // still being retried by the in-flight table
+      } else if (this->init_wait_ack_ != 0 && this->init_should_retry_()) {
+        this->init_send_(this->init_wait_stage_);
+      } else {
+        this->init_wait_ack_ = 0;
+        this->init_retries_ = 0;
+        this->init_send_(this->init_stage_);
+        if (this->write_no_rsp_) {
+          // burst mode: the rest of the chain goes out back-to-back, ACKs only feed the in-flight table
+          while (this->init_stage_ != INIT_NONE) this->init_send_(this->init_stage_);
+          this->init_wait_ack_ = 0;
         }
-    
-        default:
-          this->init_stage_ = INIT_NONE;
-          break;
       }
     }
   }
@@ -365,6 +415,11 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
         }
 
         ESP_LOGI(TAG, "handles: notify=0x%04x write=0x%04x", notify_handle_, write_handle_);
+        if (identity_cache_valid_ && (identity_cache_.notify_handle != notify_handle_ ||
+                                      identity_cache_.write_handle != write_handle_)) {
+          ESP_LOGI(TAG, "GATT handles changed since last session; updating identity cache");
+          save_identity_cache_();
+        }
 
         esp_err_t err = esp_ble_gattc_register_for_notify(gattc_if, parent->get_remote_bda(), notify_handle_);
         if (err != ESP_OK) ESP_LOGW(TAG, "register_for_notify failed: %d", (int) err);
@@ -374,21 +429,30 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
       }
 
       case ESP_GATTC_NOTIFY_EVT: {
-        ESP_LOGD(TAG, "NOTIFY handle=0x%04x len=%u", param->notify.handle, param->notify.value_len);
-      
-        std::string hx;
-        hx.reserve(param->notify.value_len * 3);
-        static const char *d = "0123456789ABCDEF";
-        for (int i = 0; i < param->notify.value_len; i++) {
-          uint8_t b = param->notify.value[i];
-          hx.push_back(d[(b >> 4) & 0xF]);
-          hx.push_back(d[b & 0xF]);
-          if (i + 1 < param->notify.value_len) hx.push_back(' ');
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE
+        {
+          // Raw dump only at VERBOSE; use packet_capture for always-on recording.
+          char hx[3 * 64 + 1];
+          static const char *d = "0123456789ABCDEF";
+          size_t pos = 0;
+          for (int i = 0; i < param->notify.value_len && pos + 3 < sizeof(hx); i++) {
+            uint8_t b = param->notify.value[i];
+            hx[pos++] = d[(b >> 4) & 0xF];
+            hx[pos++] = d[b & 0xF];
+            hx[pos++] = ' ';
+          }
+          hx[pos > 0 ? pos - 1 : 0] = '\0';
+          ESP_LOGV(TAG, "NOTIFY handle=0x%04x len=%u RX raw: %s", param->notify.handle, param->notify.value_len, hx);
         }
-        ESP_LOGD(TAG, "RX raw: %s", hx.c_str());
-      
-        // dann erst dein handle_frame_() aufrufen
-        handle_frame_(param->notify.value, param->notify.value_len);
+#endif
+
+        // Notifications are not frame aligned: reassemble before dispatching.
+        framer_.feed(param->notify.value, param->notify.value_len, millis(),
+                     [this](const uint8_t *frame, size_t len) {
+                       const PetkitAllocCount heap0 = this->heap_probe_begin_();
+                       this->handle_frame_(frame, len);
+                       this->heap_probe_end_(this->heap_.rx, "RX", len > 3 ? frame[3] : 0, heap0);
+                     });
         break;
       }
 
@@ -396,16 +460,51 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
       case ESP_GATTC_WRITE_DESCR_EVT: {
         // Existing log bleibt; dann:
         this->notify_ready_ = true;
+        this->session_ready_ = false;
+        this->cfg_fresh_ = false;
+        if (this->republish_on_reconnect_) this->invalidate_all_fields_();
+        if (this->have_secret_ && this->identity_cache_valid_) {
+          // identity from flash: straight to CMD73, CMD213 only re-checks it after the chain
+          this->auto_213_sent_ = true;
+          this->start_init_chain_();
+          ESP_LOGD(TAG, "Notify ready; cached identity, skipping CMD213");
+          break;
+        }
         this->auto_213_sent_ = false;
         this->auto_213_at_ms_ = millis() + 1500;  // 1.5s Delay, entspricht "manuell später drücken"
         ESP_LOGD(TAG, "Notify ready; scheduling auto CMD213 in 1500ms");
         break;
       }
 
+      case ESP_GATTC_WRITE_CHAR_EVT:
+        on_write_complete_(param);
+        break;
+
+      case ESP_GATTC_OPEN_EVT:
+        if (param->open.status == ESP_GATT_OK && !link_up_) {
+          link_up_ = true;
+          link_up_since_ms_ = millis();
+          first_state_pending_ = true;
+        }
+        break;
+
       case ESP_GATTC_DISCONNECT_EVT:
       case ESP_GATTC_CLOSE_EVT:
+        if (link_up_) {
+          link_up_ = false;
+          link_up_total_ms_ += millis() - link_up_since_ms_;
+        }
         notify_handle_ = 0;
         write_handle_ = 0;
+        framer_.reset();
+        init_stage_ = INIT_NONE;
+        init_wait_ack_ = 0;
+        inflight_.clear();
+        write_busy_ = false;
+        notify_ready_ = false;
+        session_ready_ = false;
+        cfg_fresh_ = false;
+        poll_sent_ms_ = 0;
         break;
 
       default:
@@ -413,6 +512,19 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
     }
   }
 
+  // ---------- session hooks (PetkitFountainManager) ----------
+  bool is_session_connected() const { return notify_ready_ && write_handle_ != 0; }
+
+  // Connected, init chain finished, state received since `since_ms` and nothing left
+  // queued, in flight or staged.
+  bool is_session_done(uint32_t since_ms) const {
+    return is_session_connected() && session_ready_ && init_stage_ == INIT_NONE && txq_.empty() &&
+           inflight_.empty() && cfg_staged_mask_ == 0 && state_seen_ &&
+           (int32_t) (last_state_ms_ - since_ms) >= 0;
+  }
+
+  bool has_pending_writes() const { return cfg_staged_mask_ != 0 || !txq_.empty(PETKIT_PRIO_CONTROL); }
+
   // ---------- called by entities ----------
   void set_light_enabled(bool on) {
   apply_config_partial_("light",
@@ -506,6 +618,7 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
       case PetkitActionButton::SET_DATETIME: cmd_set_datetime_(); break;
       case PetkitActionButton::INIT_SESSION: cmd_init_session_(); break;
       case PetkitActionButton::SYNC: cmd_sync_(); break;
+      case PetkitActionButton::DUMP_CAPTURE: dump_capture_(); break;
     }
   }
 
@@ -533,13 +646,100 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
   static constexpr const char *TAG = "petkit_fountain";
 
   bool notify_ready_{false};
+  bool session_ready_{false};  // init chain done for this connection; control writes may go out
+  bool state_seen_{false};
+  uint32_t last_state_ms_{0};  // last D2 or E6
+
+  // link time accounting (connected_fraction)
+  bool link_up_{false};
+  uint32_t link_up_since_ms_{0};
+  uint32_t link_up_total_ms_{0};
+
+  // usage accounting: lifetime/daily totals from the E6 "today" counters, kept in flash
+  static constexpr uint32_t USAGE_SAVE_MIN_INTERVAL_MS = 10 * 60 * 1000;
+  PetkitUsageAccumulator usage_;
+  ESPPreferenceObject usage_pref_;
+  float energy_scale_{0.001f};  // kWh per raw count
+  bool usage_save_pending_{false};
+  bool usage_saved_this_boot_{false};
+  uint32_t usage_last_save_ms_{0};
+  uint32_t usage_last_sample_ms_{0};  // 0 = no sample this boot
+
+  // filter life estimate, persisted on every new fit point (at most one per percent step)
+  PetkitFilterEstimator filter_est_;
+  ESPPreferenceObject filter_pref_;
+  bool filter_save_pending_{false};
+
+  // link metrics (see PetkitLinkMetrics)
+  PetkitLinkMetrics metrics_;
+  bool first_state_pending_{false};  // connected, no D2/E6 yet
+
+  // heap probe around RX/TX handlers (see PetkitHeapStats); on only if one of its sensors is configured
+  static constexpr uint64_t HEAP_FIELDS = (1ull << FIELD_HEAP_FREE) | (1ull << FIELD_HEAP_LARGEST_BLOCK) |
+                                          (1ull << FIELD_RX_HEAP_ALLOCS) | (1ull << FIELD_RX_HEAP_BYTES) |
+                                          (1ull << FIELD_TX_HEAP_ALLOCS) | (1ull << FIELD_TX_HEAP_BYTES);
+  PetkitHeapStats heap_;
+  bool heap_probe_{false};
+
+  // duty cycle
+  bool managed_{false};
+  uint32_t duty_interval_ms_{0};
+  uint32_t duty_session_timeout_ms_{30000};
+  bool duty_active_{false};
+  uint32_t duty_session_start_ms_{0};
+  uint32_t duty_next_ms_{0};
+  uint32_t duty_early_ms_{0};  // pending writes may connect early from here on
+
+  bool duty_cycling_() const { return duty_interval_ms_ != 0 && !managed_; }
+
+  // Adaptive polling (CMD210). The interval is picked per update() from the cached state;
+  // polls also draw from an airtime budget (round trip time, refilled at poll_budget_).
+  static constexpr uint32_t POLL_BUDGET_WINDOW_MS = 10 * 60 * 1000;  // bucket size = budget * window
+  static constexpr uint32_t POLL_SLACK_MS = 2000;  // state this close to due counts as due
+  uint32_t poll_idle_ms_{5 * 60 * 1000};
+  uint32_t poll_dnd_ms_{30 * 60 * 1000};
+  float poll_budget_{0.01f};
+  float poll_credit_ms_{-1.0f};  // < 0: not initialised yet
+  uint32_t poll_credit_at_ms_{0};
+  uint32_t poll_sent_ms_{0};     // outstanding poll, 0 = none
+  float poll_rtt_ms_{100.0f};    // smoothed round trip, what the next poll is expected to cost
+
+  // Same session rules as PetkitFountainManager, for a single fountain. Writes made while
+  // disconnected are queued and bring the next session forward.
+  void duty_cycle_step_() {
+    auto *client = this->parent();
+    if (!client) return;
+    const uint32_t now = millis();
+    if (!duty_active_) {
+      const bool early = has_pending_writes() && (int32_t) (now - duty_early_ms_) >= 0;
+      if ((int32_t) (now - duty_next_ms_) < 0 && !early) return;
+      ESP_LOGD(TAG, "Duty cycle: connecting%s", has_pending_writes() ? " (pending writes)" : "");
+      duty_active_ = true;
+      duty_session_start_ms_ = now;
+      client->set_enabled(true);
+      return;
+    }
+    const bool done = is_session_done(duty_session_start_ms_);
+    if (!done && (now - duty_session_start_ms_) < duty_session_timeout_ms_) return;
+    ESP_LOGD(TAG, "Duty cycle: session %s after %ums", done ? "done" : "timeout",
+             (unsigned) (now - duty_session_start_ms_));
+    duty_active_ = false;
+    duty_next_ms_ = now + duty_interval_ms_;
+    // an unreachable device must not turn queued writes into a reconnect loop
+    duty_early_ms_ = done ? now : duty_next_ms_;
+    client->set_enabled(false);
+  }
   bool auto_213_sent_{false};
   uint32_t auto_213_at_ms_{0};
 
-  std::vector<uint8_t> device_id_bytes_;
+  PetkitDeviceId device_id_bytes_{};
   uint64_t device_id_int_{0};
-  std::string serial_;
+  PetkitSerial serial_;
   bool have_identifiers_{false};
+  ESPPreferenceObject identity_pref_;
+  bool identity_cache_valid_{false};    // identity_cache_ mirrors what is in flash
+  bool identity_from_cache_{false};     // current identity not yet confirmed by CMD213 this boot
+  bool identity_verify_pending_{false};
 
   bool schedule_cmd210_{false};
   bool cmd210_sent_after_213_{false};
@@ -548,6 +748,14 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
   enum InitStage : uint8_t { INIT_NONE, INIT_SEND_73, INIT_SEND_86, INIT_SEND_84, INIT_SEND_210, INIT_SEND_211 };
   InitStage init_stage_{INIT_NONE};
   uint32_t init_at_ms_{0};
+  // The chain advances on the matching ACK; the old fixed delays are only the timeout.
+  static constexpr uint32_t INIT_START_DELAY_MS = 100;
+  static constexpr uint32_t INIT_RETRY_BACKOFF_MS = 250;
+  static constexpr uint8_t INIT_MAX_RETRIES = 2;
+  uint8_t init_wait_ack_{0};  // ACK cmd the chain is waiting for (0 = none)
+  InitStage init_wait_stage_{INIT_NONE};
+  uint8_t init_retries_{0};
+  bool init_nak_{false};  // last awaited ACK carried status != 1
   
   std::array<uint8_t, 8> secret_{};
   std::array<uint8_t, 8> device_id8_{};
@@ -566,304 +774,221 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
   uint16_t notify_handle_{0};
   uint16_t write_handle_{0};
 
-  // sensors
-  sensor::Sensor *power_{nullptr};
-  sensor::Sensor *mode_{nullptr};
-  sensor::Sensor *is_night_dnd_{nullptr};
-  sensor::Sensor *filter_percent_{nullptr};
-  sensor::Sensor *run_status_{nullptr};
-  sensor::Sensor *water_pump_runtime_seconds_{nullptr};
-  sensor::Sensor *today_pump_runtime_seconds_{nullptr};
-  sensor::Sensor *today_purified_water_times_{nullptr};
-  sensor::Sensor *today_energy_kwh_{nullptr};
-  sensor::Sensor *smart_working_time_{nullptr};
-  sensor::Sensor *smart_sleep_time_{nullptr};
-  sensor::Sensor *light_switch_{nullptr};
-  sensor::Sensor *light_brightness_{nullptr};
-  sensor::Sensor *light_schedule_start_min_{nullptr};
-  sensor::Sensor *light_schedule_end_min_{nullptr};
-  sensor::Sensor *dnd_switch_{nullptr};
-  sensor::Sensor *dnd_start_min_{nullptr};
-  sensor::Sensor *dnd_end_min_{nullptr};
-  sensor::Sensor *filter_remaining_days_{nullptr};
-
-  // binary_sensors
-  binary_sensor::BinarySensor *lack_warning_bin_{nullptr};
-  binary_sensor::BinarySensor *breakdown_warning_bin_{nullptr};
-  binary_sensor::BinarySensor *filter_warning_bin_{nullptr};
-
-
-
-  // switches (aus switch.py)
-  switch_::Switch *power_sw_{nullptr};
-  switch_::Switch *light_sw_{nullptr};
-  switch_::Switch *dnd_sw_{nullptr};
-  
-  // numbers (aus number.py)
-  number::Number *brightness_num_{nullptr};
-  number::Number *light_start_num_{nullptr};
-  number::Number *light_end_num_{nullptr};
-  number::Number *dnd_start_num_{nullptr};
-  number::Number *dnd_end_num_{nullptr};
-  PetkitSmartOnNumber *smart_on_num_{nullptr};
-  PetkitSmartOffNumber *smart_off_num_{nullptr};
+  // RX reassembly
+  PetkitFramer framer_;
 
-  
-  // select (aus select.py)
-  select::Select *mode_sel_{nullptr};
-  
-  // text_sensor (aus text_sensor.py)
-  text_sensor::TextSensor *serial_text_{nullptr};
+  // packet capture (RX/TX frames), storage allocated once in setup()
+  PetkitCapture capture_;
+  std::unique_ptr<PetkitCaptureRecord[]> capture_storage_;
+  uint16_t capture_size_{PETKIT_CAPTURE_DEFAULT};
+
+  // entity registry: dense, sorted by field; bound_mask_ has a bit per field with an entity.
+  // Each binding caches the value last published to it, unbound fields cost nothing.
+  static_assert(FIELD_COUNT <= 64, "bound_mask_ is a 64-bit mask");
+  std::array<PetkitBinding, PETKIT_BINDING_CAPACITY> bindings_{};
+  uint8_t binding_count_{0};
+  uint64_t bound_mask_{0};
 
-  // entities
-  std::vector<PetkitTimeNumber *> time_nums_{};
+  text_sensor::TextSensor *serial_text_{nullptr};
+  text_sensor::TextSensor *link_summary_text_{nullptr};
+  text_sensor::TextSensor *filter_replacement_text_{nullptr};
+  text_sensor::TextSensor *profile_text_{nullptr};
   std::vector<PetkitActionButton *> buttons_{};
 
+#ifndef PETKIT_MODEL_PROFILE
+  uint8_t profile_seen_e6_len_{0};  // auto: E6 length the layout was inferred from
+#endif
+
+  uint32_t full_republish_interval_ms_{0};  // 0 = only publish changes
+  uint32_t last_full_republish_ms_{0};
+  bool republish_on_reconnect_{true};
+
   // state cache
   uint8_t last_power_{0};
   uint8_t last_mode_{1};
-  std::vector<uint8_t> last_config_payload_;  // 13 bytes baseline for CMD221
+  // inputs of poll_interval_(), kept whether or not an entity shows them
+  uint8_t last_run_status_{0};
+  bool last_night_dnd_{false};
+  bool last_warning_{false};
+  uint8_t last_dnd_sw_{0};
+  uint16_t last_dnd_start_{0};
+  uint16_t last_dnd_end_{0};
+  std::array<uint8_t, PETKIT_CONFIG_LEN> last_config_payload_{};  // baseline for CMD221
+  bool have_config_payload_{false};
+
+  // CMD221 coalescing: partial changes are staged per byte and merged into one write.
+  static constexpr uint32_t CONFIG_COALESCE_MAX_MS = 1000;
+  uint32_t config_coalesce_ms_{200};
+  std::array<uint8_t, PETKIT_CONFIG_LEN> cfg_staged_{};
+  uint16_t cfg_staged_mask_{0};  // bit i set: cfg_staged_[i] overrides the baseline
+  bool cfg_batch_open_{false};
+  bool cfg_baseline_requested_{false};
+  // CMD211 baseline requests that ran out of retries; the batch is dropped at the limit
+  static constexpr uint8_t CONFIG_BASELINE_MAX_MISSES = 3;
+  uint8_t cfg_baseline_misses_{0};
+  bool cfg_fresh_{false};  // a D3 arrived in this session; until then the baseline may be stale
+  uint32_t cfg_batch_start_ms_{0};
+  uint32_t cfg_flush_at_ms_{0};
+
+  // Persisted CMD221 baseline (last config confirmed by a D3). Flash writes are throttled.
+  static constexpr uint32_t CONFIG_SAVE_MIN_INTERVAL_MS = 10 * 60 * 1000;
+  ESPPreferenceObject config_pref_;
+  std::array<uint8_t, PETKIT_CONFIG_LEN> cfg_saved_{};
+  std::array<uint8_t, PETKIT_CONFIG_LEN> cfg_confirmed_{};  // last D3, what gets saved
+  bool cfg_saved_valid_{false};         // cfg_saved_ mirrors what is in flash
+  bool cfg_saved_this_boot_{false};
+  bool cfg_save_pending_{false};
+  bool cfg_baseline_from_flash_{false};  // baseline not yet confirmed by a D3
+  uint32_t cfg_last_save_ms_{0};
   uint8_t last_filter_percent_raw_{0};  // 0..100
   uint8_t last_smart_on_min_{0};        // 0..255 (min)
   uint8_t last_smart_off_min_{0};       // 0..255 (min)
 
 
-  // tx queue
-  struct PendingCmd { uint8_t cmd; uint8_t type; std::vector<uint8_t> data; };
-  std::deque<PendingCmd> txq_;
+  // tx queue (fixed rings per priority class, payloads inline; steady-state TX never allocates)
+  static constexpr size_t TX_QUEUE_PER_CLASS = 8;
+  PetkitTxQueue<TX_QUEUE_PER_CLASS> txq_;
   uint8_t seq_{0};
-  uint32_t last_tx_ms_{0};
-
-  static uint16_t u16_be_(const uint8_t *p) { return (uint16_t(p[0]) << 8) | uint16_t(p[1]); }
-  static uint32_t u32_be_(const uint8_t *p) {
-    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+  uint32_t tx_dropped_{0};    // queue class full
+  uint32_t tx_collapsed_{0};  // read already pending
+
+  // Sent commands awaiting their reply. Writes are paced by WRITE_CHAR_EVT (one GATT
+  // write outstanding) and by the reply window, not by a fixed gap.
+  static constexpr size_t INFLIGHT_SIZE = 4;
+  static constexpr uint32_t REPLY_TIMEOUT_MS = 750;
+  static constexpr uint8_t MAX_RETRIES = 2;
+  static constexpr uint32_t WRITE_EVT_TIMEOUT_MS = 500;  // fallback if WRITE_CHAR_EVT never arrives
+  PetkitInflightTable<INFLIGHT_SIZE> inflight_;
+  bool write_busy_{false};
+  uint8_t write_busy_seq_{0};
+  uint32_t write_busy_since_ms_{0};
+  bool write_acks_seen_{false};  // device ACKs writes, so unanswered writes may be resent
+  // Burst mode: ESP_GATT_WRITE_TYPE_NO_RSP, as many frames per loop as the controller has
+  // buffer credits for; the in-flight table's ACK tracking confirms delivery.
+  static constexpr size_t BURST_MAX = INFLIGHT_SIZE;
+  bool write_no_rsp_{false};
+
+  std::array<uint8_t, PETKIT_TIME_PAYLOAD_LEN> build_time_bytes_() {
+    // If system time isn't set, we still return something deterministic to avoid empty writes.
+    // You can also skip CMD84 if time is invalid.
+    return petkit_build_time_bytes_(::time(nullptr));
   }
 
-  struct PetkitStateD2 {
-    bool ok{false};
-    uint8_t seq{0};
-  
-    uint8_t power{0};
-    uint8_t mode{0};
-    uint8_t night_dnd{0};
-    uint8_t breakdown_warn{0};
-    uint8_t lack_warn{0};
-    uint8_t filter_warn{0};
-  
-    uint8_t filter_percent{0};
-    uint8_t run_status{0};
-  };
-  
-  static PetkitStateD2 petkit_parse_state_d2_(const uint8_t *frame, size_t len) {
-    PetkitStateD2 out;
-    if (len < 9) return out;
-    if (frame[0] != 0xFA || frame[1] != 0xFC || frame[2] != 0xFD) return out;
-    if (frame[len - 1] != 0xFB) return out;
-  
-    const uint8_t cmd = frame[3];
-    const uint8_t type = frame[4];
-    const uint8_t seq = frame[5];
-    const uint8_t dlen = frame[6];
-  
-    if (cmd != 0xD2) return out;
-    if (type != 0x02) return out;
-    if (len != (size_t)(9 + dlen)) return out;
-  
-    const uint8_t *d = frame + 8;
-    const size_t dl = dlen;
-  
-    // Need at least up to filter_percent/run_status indices we use
-    if (dl < 12) return out;
-  
-    out.seq = seq;
-    out.power = d[0];
-    out.mode = d[1];
-    out.night_dnd = d[2];
-    out.breakdown_warn = d[3];
-    out.lack_warn = d[4];
-    out.filter_warn = d[5];
-  
-    // These offsets match your observed payload (0x64 at position 10)
-    out.filter_percent = d[10];
-    out.run_status = d[11];
-  
-    out.ok = true;
-    return out;
-  }
 
-  struct PetkitConfigD3 {
-    bool ok{false};
-    uint8_t seq{0};
-  
-    uint8_t smart_on{0};
-    uint8_t smart_off{0};
-  
-    uint8_t light_sw{0};
-    uint8_t brightness{0};
-    uint16_t light_start{0};
-    uint16_t light_end{0};
-  
-    uint8_t dnd_sw{0};
-    uint16_t dnd_start{0};
-    uint16_t dnd_end{0};
-  };
-  
-  static PetkitConfigD3 petkit_parse_config_d3_(const uint8_t *frame, size_t len) {
-    PetkitConfigD3 out;
-    if (len < 9) return out;
-    if (frame[0] != 0xFA || frame[1] != 0xFC || frame[2] != 0xFD) return out;
-    if (frame[len - 1] != 0xFB) return out;
-  
-    const uint8_t cmd = frame[3];
-    const uint8_t type = frame[4];
-    const uint8_t seq  = frame[5];
-    const uint8_t dlen = frame[6];
-  
-    if (cmd != 0xD3) return out;
-    if (type != 0x02) return out;
-    if (len != (size_t)(9 + dlen)) return out;
-  
-    // Expected config payload length = 13 bytes
-    if (dlen != 13) return out;
-  
-    const uint8_t *d = frame + 8;
-  
-    out.seq = seq;
+  void compute_secret_from_device_id_() {
+    // device_id_bytes_ may be all 0
+    petkit_compute_secret_(this->device_id_bytes_, device_id8_, secret_);
   
-    // Layout (13 bytes):
-    // 0 smart_on, 1 smart_off, 2 light_sw, 3 brightness,
-    // 4..5 light_start, 6..7 light_end,
-    // 8 dnd_sw, 9..10 dnd_start, 11..12 dnd_end
-    out.smart_on    = d[0];
-    out.smart_off   = d[1];
-    out.light_sw    = d[2];
-    out.brightness  = d[3];
-    out.light_start = u16_be_(d + 4);
-    out.light_end   = u16_be_(d + 6);
-    out.dnd_sw      = d[8];
-    out.dnd_start   = u16_be_(d + 9);
-    out.dnd_end     = u16_be_(d + 11);
+    have_secret_ = true;
   
-    out.ok = true;
-    return out;
+    ESP_LOGI(TAG, "Secret computed. device_id8=%02X%02X%02X%02X%02X%02X%02X%02X secret=%02X%02X%02X%02X%02X%02X%02X%02X",
+             device_id8_[0], device_id8_[1], device_id8_[2], device_id8_[3], device_id8_[4], device_id8_[5], device_id8_[6], device_id8_[7],
+             secret_[0], secret_[1], secret_[2], secret_[3], secret_[4], secret_[5], secret_[6], secret_[7]);
   }
 
-  struct PetkitAck {
-    bool ok{false};
-    uint8_t cmd{0};
-    uint8_t seq{0};
-    uint8_t value{0};  // usually 1 = ok
-  };
-  
-  static PetkitAck petkit_parse_ack_(const uint8_t *frame, size_t len) {
-    PetkitAck out;
-    if (len < 9) return out;
-    if (frame[0] != 0xFA || frame[1] != 0xFC || frame[2] != 0xFD) return out;
-    if (frame[len - 1] != 0xFB) return out;
-  
-    const uint8_t cmd = frame[3];
-    const uint8_t type = frame[4];
-    const uint8_t seq = frame[5];
-    const uint8_t dlen = frame[6];
-  
-    if (type != 0x02) return out;
-    if (len != (size_t)(9 + dlen)) return out;
-    if (dlen < 1) return out;
-  
-    out.ok = true;
-    out.cmd = cmd;
-    out.seq = seq;
-    out.value = frame[8];
-    return out;
+
+  PetkitPendingCmd *alloc_pending_(uint8_t cmd, uint8_t type) {
+    PetkitPendingCmd *p = txq_.push(petkit_tx_prio_(cmd));
+    if (p == nullptr) {
+      tx_dropped_++;
+      ESP_LOGW(TAG, "TX queue full, dropping cmd=%u", (unsigned) cmd);
+      return nullptr;
+    }
+    p->cmd = cmd;
+    p->type = type;
+    p->len = 0;
+    p->read_template = false;
+    metrics_.on_queue_depth(txq_.size());
+    return p;
   }
 
-  std::vector<uint8_t> build_time_bytes_() {
-    // Build payload like Python Utils.time_in_bytes():
-    // [0, sec>>24, sec>>16, sec>>8, sec, 13]
-    // sec = seconds since 2000-01-01 00:00:00 UTC
-  
-    std::vector<uint8_t> out;
-    out.reserve(6);
-  
-    // If system time isn't set, we still return something deterministic to avoid empty writes.
-    // You can also skip CMD84 if time is invalid.
-    time_t now_unix = time(nullptr);
-  
-    // 2000-01-01 00:00:00 UTC in Unix epoch seconds
-    const int64_t unix_to_2000 = 946684800LL;
-  
-    int64_t sec2000 = (int64_t) now_unix - unix_to_2000;
-    if (sec2000 < 0) sec2000 = 0;  // clamp if clock not set
-  
-    uint32_t s = (uint32_t) sec2000;
-  
-    out.push_back(0x00);
-    out.push_back((s >> 24) & 0xFF);
-    out.push_back((s >> 16) & 0xFF);
-    out.push_back((s >> 8) & 0xFF);
-    out.push_back((s) & 0xFF);
-    out.push_back(0x0D);  // 13
-  
-    return out;
+  void enqueue_(uint8_t cmd, uint8_t type, const uint8_t *data, size_t len) {
+    if (len > PETKIT_MAX_PAYLOAD) {
+      ESP_LOGW(TAG, "TX payload too long cmd=%u len=%u", (unsigned) cmd, (unsigned) len);
+      return;
+    }
+    PetkitPendingCmd *p = alloc_pending_(cmd, type);
+    if (p == nullptr) return;
+    std::copy(data, data + len, p->data.begin());
+    p->len = (uint8_t) len;
   }
 
+  void enqueue_(uint8_t cmd, uint8_t type, std::initializer_list<uint8_t> data) {
+    enqueue_(cmd, type, data.begin(), data.size());
+  }
 
-  void compute_secret_from_device_id_() {
-    // device_id_bytes_ is 6 bytes (may be all 0)
-    // Build device_id8_ = pad left with zeros to 8
-    device_id8_.fill(0);
-    int di_len = (int) this->device_id_bytes_.size();
-    for (int i = 0; i < di_len && i < 8; i++) {
-      device_id8_[8 - di_len + i] = this->device_id_bytes_[i];
+  static const PetkitReadTemplate *read_template_(uint8_t cmd) {
+    static constexpr PetkitReadTemplate TMPL_210 = petkit_make_read_template_(210);
+    static constexpr PetkitReadTemplate TMPL_211 = petkit_make_read_template_(211);
+    static constexpr PetkitReadTemplate TMPL_213 = petkit_make_read_template_(213);
+    static constexpr PetkitReadTemplate TMPL_66 = petkit_make_read_template_(66);
+    switch (cmd) {
+      case 210: return &TMPL_210;
+      case 211: return &TMPL_211;
+      case 213: return &TMPL_213;
+      case 66: return &TMPL_66;
+      default: return nullptr;
     }
-  
-    // secret = reverse(device_id_bytes) + replace last two if zero + pad left to 8
-    std::vector<uint8_t> tmp = this->device_id_bytes_;
-    std::reverse(tmp.begin(), tmp.end());
-    if (tmp.size() >= 2 && tmp[tmp.size() - 1] == 0 && tmp[tmp.size() - 2] == 0) {
-      tmp[tmp.size() - 2] = 13;
-      tmp[tmp.size() - 1] = 37;
-    }
-  
-    secret_.fill(0);
-    int s_len = (int) tmp.size();
-    for (int i = 0; i < s_len && i < 8; i++) {
-      secret_[8 - s_len + i] = tmp[i];
+  }
+
+  // Request with data=[0,0] (CMD210/211/213/66), sent from a prebuilt frame template.
+  // Reads are idempotent: one still waiting in the queue answers a repeated request too.
+  void enqueue_read_(uint8_t cmd) {
+    if (txq_.contains(petkit_tx_prio_(cmd), cmd)) {
+      tx_collapsed_++;
+      ESP_LOGV(TAG, "CMD%u already queued", (unsigned) cmd);
+      return;
     }
-  
-    have_secret_ = true;
-  
-    ESP_LOGI(TAG, "Secret computed. device_id8=%02X%02X%02X%02X%02X%02X%02X%02X secret=%02X%02X%02X%02X%02X%02X%02X%02X",
-             device_id8_[0], device_id8_[1], device_id8_[2], device_id8_[3], device_id8_[4], device_id8_[5], device_id8_[6], device_id8_[7],
-             secret_[0], secret_[1], secret_[2], secret_[3], secret_[4], secret_[5], secret_[6], secret_[7]);
+    PetkitPendingCmd *p = alloc_pending_(cmd, PETKIT_TYPE_REQUEST);
+    if (p == nullptr) return;
+    p->data[0] = 0x00;
+    p->data[1] = 0x00;
+    p->len = 2;
+    p->read_template = read_template_(cmd) != nullptr;
   }
 
+  // CMD73 payload: [0,0] + device_id(8) + secret(8)
+  void enqueue_cmd73_() {
+    std::array<uint8_t, 2 + 8 + 8> payload{};
+    std::copy(device_id8_.begin(), device_id8_.end(), payload.begin() + 2);
+    std::copy(secret_.begin(), secret_.end(), payload.begin() + 2 + 8);
+    enqueue_(73, 1, payload.data(), payload.size());
+  }
 
-  std::vector<uint8_t> build_cmd_(uint8_t seq, uint8_t cmd, uint8_t type,
-                                 const std::vector<uint8_t> &data) {
-    std::vector<uint8_t> out;
-    out.reserve(3 + 1 + 1 + 1 + 1 + 1 + data.size() + 1);
-  
-    out.push_back(0xFA);
-    out.push_back(0xFC);
-    out.push_back(0xFD);
-    out.push_back(cmd);
-    out.push_back(type);
-    out.push_back(seq);
-    out.push_back((uint8_t) data.size());
-    out.push_back(0x00);              // data_start
-    out.insert(out.end(), data.begin(), data.end());
-    out.push_back(0xFB);              // end_byte
-  
-    return out;
+  // CMD86 payload: [0,0] + secret(8)
+  void enqueue_cmd86_() {
+    std::array<uint8_t, 2 + 8> payload{};
+    std::copy(secret_.begin(), secret_.end(), payload.begin() + 2);
+    enqueue_(86, 1, payload.data(), payload.size());
   }
 
-  void enqueue_(uint8_t cmd, uint8_t type, std::vector<uint8_t> data) {
-    txq_.push_back(PendingCmd{cmd, type, std::move(data)});
+  // Logs the capture ring oldest first, one PKCAP1 line per frame (see petkit_format_capture_()).
+  void dump_capture_() {
+    if (!capture_.enabled()) {
+      ESP_LOGW(TAG, "Packet capture disabled (packet_capture: 0 in YAML)");
+      return;
+    }
+    ESP_LOGI(TAG, "PKCAP1 BEGIN records=%u total=%u now=%u", (unsigned) capture_.size(),
+             (unsigned) capture_.get_total(), (unsigned) millis());
+    char line[PETKIT_CAPTURE_LINE_MAX];
+    capture_.for_each([&line](const PetkitCaptureRecord &r) {
+      petkit_format_capture_(r, line, sizeof(line));
+      ESP_LOGI(TAG, "%s", line);
+    });
+    ESP_LOGI(TAG, "PKCAP1 END");
   }
 
   void publish_filter_remaining_days_() {
-    if (!filter_remaining_days_) return;
+    // learned rate once there is enough history, otherwise the fixed 30-day model below
+    const auto est = filter_est_.estimate(std::min<uint8_t>(last_filter_percent_raw_, 100));
+    if (est.ok) {
+      publish_field_(FIELD_FILTER_REMAINING_DAYS, std::ceil(est.days));
+      publish_field_(FIELD_FILTER_DAYS_LOW, std::floor(est.days_low));
+      publish_field_(FIELD_FILTER_DAYS_HIGH, std::ceil(est.days_high));
+      publish_filter_replacement_(est);
+      return;
+    }
+    if (!is_bound_(FIELD_FILTER_REMAINING_DAYS)) return;
   
     // clamp percent 0..100
     uint8_t fp = last_filter_percent_raw_;
@@ -892,81 +1017,215 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
     // Safety against NaN/Inf
     if (!std::isfinite(days) || days < 0.0f) days = 0.0f;
   
-    filter_remaining_days_->publish_state(days);
+    publish_field_(FIELD_FILTER_REMAINING_DAYS, days);
   }
 
 
   void process_tx_queue_() {
-    if (txq_.empty()) return;
     auto *parent = this->parent();
     if (!parent || write_handle_ == 0) return;
 
     const uint32_t now = millis();
-    if ((now - last_tx_ms_) < 120) return;
+    if (write_busy_) {
+      if ((now - write_busy_since_ms_) < WRITE_EVT_TIMEOUT_MS) return;
+      ESP_LOGD(TAG, "No write completion for seq=%u, continuing", (unsigned) write_busy_seq_);
+      write_busy_ = false;
+    }
+
+    size_t budget = 1;
+    if (write_no_rsp_) {
+      budget = std::min<size_t>(esp_ble_get_cur_sendable_packets_num(parent->get_conn_id()), BURST_MAX);
+    }
+    while (budget-- > 0 && tx_next_(now)) {
+    }
+  }
 
-    PendingCmd p = std::move(txq_.front());
-    txq_.pop_front();
+  // Sends one frame (a retry first, else the queue head); false if nothing was written.
+  bool tx_next_(uint32_t now) {
+    // Unanswered commands: resend while retries remain, otherwise give up on them.
+    while (PetkitInflight *e = inflight_.expired(now)) {
+      if (e->attempts <= MAX_RETRIES && retry_allowed_(e->cmd.cmd)) {
+        ESP_LOGW(TAG, "No reply to cmd=%u seq=%u, retry %u/%u", (unsigned) e->cmd.cmd, (unsigned) e->seq,
+                 (unsigned) e->attempts, (unsigned) MAX_RETRIES);
+        e->attempts++;
+        e->seq = seq_;
+        e->deadline_ms = now + REPLY_TIMEOUT_MS;
+        e->sent_ms = now;
+        metrics_.retries++;
+        const PetkitAllocCount heap0 = heap_probe_begin_();
+        const bool ok = write_cmd_(e->cmd, now);
+        heap_probe_end_(heap_.tx, "TX", e->cmd.cmd, heap0);
+        return ok;
+      }
+      if (retry_allowed_(e->cmd.cmd)) {
+        ESP_LOGW(TAG, "No reply to cmd=%u after %u attempt(s)", (unsigned) e->cmd.cmd, (unsigned) e->attempts);
+        metrics_.on_timeout(e->cmd.cmd);
+        finish_inflight_(*e, false);
+      } else {
+        // unconfirmed, not failed: no ACK was expected, so on_done has nothing to recover
+        ESP_LOGD(TAG, "No reply to cmd=%u (device does not ACK writes)", (unsigned) e->cmd.cmd);
+        inflight_.release(*e);
+      }
+    }
+
+    // Control writes are held until the session is initialised (see session_ready_).
+    const PetkitTxPrio from = session_ready_ ? PETKIT_PRIO_CONTROL : PETKIT_PRIO_SESSION;
+    PetkitPendingCmd *next = txq_.peek(from);
+    if (next == nullptr || inflight_.full()) return false;
+
+    const PetkitPendingCmd &p = *next;
+    const uint8_t used_seq = seq_;
+    const PetkitAllocCount heap0 = heap_probe_begin_();
+    const bool ok = write_cmd_(p, now);
+    heap_probe_end_(heap_.tx, "TX", p.cmd, heap0);
+    // Commands with a known reply are tracked; a failed write is retried like a lost reply.
+    if (dispatch_entry_(p.cmd).handler != nullptr && (ok || retry_allowed_(p.cmd))) {
+      PetkitInflight *e = inflight_.add(p, used_seq, ok ? now + REPLY_TIMEOUT_MS : now + WRITE_EVT_TIMEOUT_MS);
+      if (e != nullptr) e->sent_ms = now;
+    }
+    txq_.pop(from);
+    return ok;
+  }
+
+  // Encodes p with the next seq and writes it; the only place that issues GATT writes.
+  bool write_cmd_(const PetkitPendingCmd &p, uint32_t now) {
+    auto *parent = this->parent();
 
-    auto frame = build_cmd_(seq_, p.cmd, p.type, p.data);
+    std::array<uint8_t, PETKIT_MAX_TX_FRAME> frame;
+    size_t frame_len;
+    if (p.read_template) {
+      const PetkitReadTemplate *tmpl = read_template_(p.cmd);
+      std::copy(tmpl->begin(), tmpl->end(), frame.begin());
+      frame[PETKIT_SEQ_OFFSET] = seq_;
+      frame_len = tmpl->size();
+    } else {
+      frame_len = petkit_encode_cmd_(frame.data(), frame.size(), seq_, p.cmd, p.type, p.data.data(), p.len);
+    }
     uint8_t used_seq = seq_;
     seq_ = uint8_t(seq_ + 1);
 
     esp_err_t err = esp_ble_gattc_write_char(
         parent->get_gattc_if(), parent->get_conn_id(), write_handle_,
-        frame.size(), (uint8_t *) frame.data(),
-        ESP_GATT_WRITE_TYPE_RSP, ESP_GATT_AUTH_REQ_NONE);
+        frame_len, frame.data(),
+        write_no_rsp_ ? ESP_GATT_WRITE_TYPE_NO_RSP : ESP_GATT_WRITE_TYPE_RSP, ESP_GATT_AUTH_REQ_NONE);
 
     if (err != ESP_OK) {
       ESP_LOGW(TAG, "write_char failed cmd=%u err=%d", (unsigned) p.cmd, (int) err);
-    } else {
-      ESP_LOGD(TAG, "TX cmd=%u type=%u seq=%u len=%u", (unsigned) p.cmd, (unsigned) p.type, (unsigned) used_seq,
-               (unsigned) p.data.size());
+      return false;
     }
-    last_tx_ms_ = now;
+    capture_.record(now, PETKIT_CAPTURE_TX, frame.data(), frame_len);
+    metrics_.tx_frames++;
+    ESP_LOGD(TAG, "TX cmd=%u type=%u seq=%u len=%u", (unsigned) p.cmd, (unsigned) p.type, (unsigned) used_seq,
+             (unsigned) p.len);
+    if (write_no_rsp_) return true;
+    write_busy_ = true;
+    write_busy_seq_ = used_seq;
+    write_busy_since_ms_ = now;
+    return true;
   }
 
+  // Reads are always answered; writes only once the device has been seen to ACK one.
+  bool retry_allowed_(uint8_t cmd) const { return read_template_(cmd) != nullptr || write_acks_seen_; }
+
+  void finish_inflight_(PetkitInflight &e, bool answered) {
+    const PetkitInflight done = e;
+    inflight_.release(e);
+    const PetkitCmdEntry &d = dispatch_entry_(done.cmd.cmd);
+    if (d.on_done != nullptr) (this->*d.on_done)(done, answered);
+  }
+
+  void on_write_complete_(const esp_ble_gattc_cb_param_t *param) {
+    if (param->write.handle != write_handle_ || !write_busy_) return;
+    write_busy_ = false;
+    if (param->write.status != ESP_GATT_OK) {
+      ESP_LOGW(TAG, "Write seq=%u failed status=%d", (unsigned) write_busy_seq_, (int) param->write.status);
+      PetkitInflight *e = inflight_.find_seq(write_busy_seq_);
+      if (e != nullptr) e->deadline_ms = millis();
+    }
+    process_tx_queue_();
+  }
+
+  // Completion callbacks (see PetkitCmdEntry::on_done). Entities were published
+  // optimistically, so re-read the device when a write is lost.
+  void on_identifiers_done_(const PetkitInflight &, bool answered) {
+    if (answered || session_ready_) return;
+    ESP_LOGW(TAG, "No CMD213 reply; sending queued writes without init chain");
+    session_ready_ = true;
+  }
+
+  void on_mode_write_done_(const PetkitInflight &, bool answered) {
+    if (answered) return;
+    ESP_LOGW(TAG, "CMD220 not acknowledged; re-reading state");
+    cmd_get_state_();
+  }
+
+  void on_config_write_done_(const PetkitInflight &, bool answered) {
+    if (answered) return;
+    ESP_LOGW(TAG, "CMD221 not acknowledged; re-reading config");
+    cmd_get_config_();
+  }
+
+  void on_filter_reset_done_(const PetkitInflight &, bool answered) {
+    if (answered) return;
+    ESP_LOGW(TAG, "CMD222 not acknowledged; re-reading state");
+    cmd_get_state_();
+  }
+
+  // A batch waiting for its baseline must not wait for a CMD211 that will never be answered.
+  void on_config_read_done_(const PetkitInflight &, bool answered) {
+    if (answered || cfg_staged_mask_ == 0 || have_config_payload_) return;
+    cfg_baseline_requested_ = false;
+    if (++cfg_baseline_misses_ < CONFIG_BASELINE_MAX_MISSES) return;  // flush_config_() asks again
+    ESP_LOGW(TAG, "CMD221: no baseline config after %u requests; dropping staged changes",
+             (unsigned) cfg_baseline_misses_);
+    cfg_staged_mask_ = 0;
+    cfg_batch_open_ = false;
+    cfg_baseline_misses_ = 0;
+  }
+
+  bool config_read_pending_() const { return txq_.contains(PETKIT_PRIO_POLL, 211) || inflight_.contains(211); }
+
   // commands
-  void cmd_get_state_() { enqueue_(210, 1, {0x00, 0x00}); }
-  void cmd_get_config_() { enqueue_(211, 1, {0x00, 0x00}); }
-  void cmd_get_battery_() { enqueue_(66, 1, {0x00, 0x00}); }
+  void cmd_get_state_() { enqueue_read_(210); }
+  void cmd_get_config_() { enqueue_read_(211); }
+  void cmd_get_battery_() { enqueue_read_(66); }
   void cmd_refresh_() {
           cmd_get_state_();
           // cmd_get_config_();
           // cmd_get_battery_();
   }
 
-  void cmd_set_mode_(bool on, uint8_t mode) { enqueue_(220, 1, {(uint8_t) (on ? 1 : 0), mode}); cmd_get_config_();  publish_filter_remaining_days_(); }
+  void cmd_set_mode_(bool on, uint8_t mode) {
+    enqueue_(220, 1, {(uint8_t) (on ? 1 : 0), mode});
+    // entities published optimistically; make sure the device's answer is published
+    invalidate_field_(FIELD_POWER);
+    invalidate_field_(FIELD_MODE);
+    cmd_get_config_();
+    publish_filter_remaining_days_();
+  }
   void cmd_reset_filter_() { enqueue_(222, 1, {0x00}); }
 
-  void cmd_set_datetime_() { enqueue_(84, 1, build_time_bytes_()); }
+  void cmd_set_datetime_() {
+    const auto t = build_time_bytes_();
+    enqueue_(84, 1, t.data(), t.size());
+  }
 
   void cmd_init_session_() {
     if (!have_secret_) {
       ESP_LOGW(TAG, "CMD73 requested without secret; requesting CMD213 first");
-      enqueue_(213, 1, {0x00, 0x00});
+      enqueue_read_(213);
       return;
     }
-    std::vector<uint8_t> payload;
-    payload.reserve(2 + 8 + 8);
-    payload.push_back(0x00);
-    payload.push_back(0x00);
-    payload.insert(payload.end(), device_id8_.begin(), device_id8_.end());
-    payload.insert(payload.end(), secret_.begin(), secret_.end());
-    enqueue_(73, 1, payload);
+    enqueue_cmd73_();
   }
 
   void cmd_sync_() {
     if (!have_secret_) {
       ESP_LOGW(TAG, "CMD86 requested without secret; requesting CMD213 first");
-      enqueue_(213, 1, {0x00, 0x00});
+      enqueue_read_(213);
       return;
     }
-    std::vector<uint8_t> payload;
-    payload.reserve(2 + 8);
-    payload.push_back(0x00);
-    payload.push_back(0x00);
-    payload.insert(payload.end(), secret_.begin(), secret_.end());
-    enqueue_(86, 1, payload);
+    enqueue_cmd86_();
   }
 
   void apply_config_partial_(const char *reason,
@@ -975,346 +1234,989 @@ class PetkitFountain : public PollingComponent, public ble_client::BLEClientNode
                             int dnd_switch,
                             int light_start_min, int light_end_min,
                             int dnd_start_min, int dnd_end_min) {
-    if (last_config_payload_.empty()) {
-      ESP_LOGW(TAG, "Set %s: no baseline config yet -> requesting config", reason);
-      cmd_get_config_();
+    // entities published optimistically; make sure the device's answer is published
+    if (smart_work >= 0) invalidate_field_(FIELD_SMART_ON);
+    if (smart_sleep >= 0) invalidate_field_(FIELD_SMART_OFF);
+    if (light_switch >= 0) invalidate_field_(FIELD_LIGHT_SW);
+    if (light_brightness >= 0) invalidate_field_(FIELD_BRIGHTNESS);
+    if (dnd_switch >= 0) invalidate_field_(FIELD_DND_SW);
+    if (light_start_min >= 0) invalidate_field_(FIELD_LIGHT_START);
+    if (light_end_min >= 0) invalidate_field_(FIELD_LIGHT_END);
+    if (dnd_start_min >= 0) invalidate_field_(FIELD_DND_START);
+    if (dnd_end_min >= 0) invalidate_field_(FIELD_DND_END);
+
+    auto stage = [this](size_t i, uint8_t v) {
+      cfg_staged_[i] = v;
+      cfg_staged_mask_ |= uint16_t(1u << i);
+    };
+    auto stage_min = [&stage](size_t i, int m) {
+      stage(i, (uint8_t) ((m >> 8) & 0xFF));
+      stage(i + 1, (uint8_t) (m & 0xFF));
+    };
+    if (smart_work >= 0) stage(0, (uint8_t) smart_work);
+    if (smart_sleep >= 0) stage(1, (uint8_t) smart_sleep);
+    if (light_switch >= 0) stage(2, (uint8_t) light_switch);
+    if (light_brightness >= 0) stage(3, (uint8_t) light_brightness);
+    if (light_start_min >= 0) stage_min(4, light_start_min);
+    if (light_end_min >= 0) stage_min(6, light_end_min);
+    if (dnd_switch >= 0) stage(8, (uint8_t) dnd_switch);
+    if (dnd_start_min >= 0) stage_min(9, dnd_start_min);
+    if (dnd_end_min >= 0) stage_min(11, dnd_end_min);
+
+    // Debounce: every change restarts the window, but a batch is never held longer than the cap.
+    const uint32_t now = millis();
+    if (!cfg_batch_open_) {
+      cfg_batch_open_ = true;
+      cfg_batch_start_ms_ = now;
+    }
+    cfg_flush_at_ms_ = now + config_coalesce_ms_;
+    if ((int32_t) (cfg_flush_at_ms_ - (cfg_batch_start_ms_ + CONFIG_COALESCE_MAX_MS)) > 0)
+      cfg_flush_at_ms_ = cfg_batch_start_ms_ + CONFIG_COALESCE_MAX_MS;
+    ESP_LOGD(TAG, "Set %s: staged for CMD221", reason);
+  }
+
+  // Merges the staged bytes over the current baseline and sends one CMD221 plus one read-back.
+  void flush_config_() {
+    if (!have_config_payload_) {
+      // keep the batch; on_config_() flushes it once the baseline is there. The request is
+      // renewed if it was lost with the connection or ran out of retries.
+      if (!cfg_baseline_requested_ || !config_read_pending_()) {
+        ESP_LOGW(TAG, "CMD221: no baseline config yet -> requesting config");
+        cfg_baseline_requested_ = true;
+        cmd_get_config_();
+      }
       return;
     }
-    if (last_config_payload_.size() < 13) {
-      ESP_LOGW(TAG, "Set %s: baseline config too short (%u)", reason, (unsigned) last_config_payload_.size());
+    // Merge over this session's D3, not a baseline from flash or an earlier session: hold the
+    // batch through the init chain and while its CMD211 is pending. Without that reply the
+    // older baseline is used.
+    if (!cfg_fresh_ && (!session_ready_ || config_read_pending_())) return;
+
+    auto cfg = last_config_payload_;
+    for (size_t i = 0; i < PETKIT_CONFIG_LEN; i++) {
+      if (cfg_staged_mask_ & (1u << i)) cfg[i] = cfg_staged_[i];
+    }
+    cfg_staged_mask_ = 0;
+    cfg_batch_open_ = false;
+    cfg_baseline_requested_ = false;
+    cfg_baseline_misses_ = 0;
+
+    if (cfg == last_config_payload_) {
+      ESP_LOGD(TAG, "CMD221 skipped: matches device config");
+      // nothing is sent, so republish the device's values over the optimistic entity states
+      republish_config_();
       return;
     }
 
-    std::vector<uint8_t> cfg = last_config_payload_;
-
-    if (smart_work >= 0) cfg[0] = (uint8_t) smart_work;
-    if (smart_sleep >= 0) cfg[1] = (uint8_t) smart_sleep;
-    if (light_switch >= 0) cfg[2] = (uint8_t) light_switch;
-    if (light_brightness >= 0) cfg[3] = (uint8_t) light_brightness;
-    if (light_start_min >= 0) { cfg[4] = (uint8_t)((light_start_min >> 8) & 0xFF); cfg[5] = (uint8_t)(light_start_min & 0xFF); }
-    if (light_end_min >= 0)   { cfg[6] = (uint8_t)((light_end_min >> 8) & 0xFF);   cfg[7] = (uint8_t)(light_end_min & 0xFF); }
-    if (dnd_switch >= 0) cfg[8] = (uint8_t) dnd_switch;
-    if (dnd_start_min >= 0)   { cfg[9] = (uint8_t)((dnd_start_min >> 8) & 0xFF);   cfg[10] = (uint8_t)(dnd_start_min & 0xFF); }
-    if (dnd_end_min >= 0)     { cfg[11] = (uint8_t)((dnd_end_min >> 8) & 0xFF);    cfg[12] = (uint8_t)(dnd_end_min & 0xFF); }
-
-    enqueue_(221, 1, cfg);
-    ESP_LOGI(TAG, "Queued CMD221 (%s)", reason);
+    enqueue_(221, 1, cfg.data(), cfg.size());
+    ESP_LOGI(TAG, "Queued CMD221");
     last_config_payload_ = cfg;
 
     last_smart_on_min_  = cfg[0];
     last_smart_off_min_ = cfg[1];
-    
+
     publish_filter_remaining_days_();
     cmd_get_config_();
   }
 
+  // ---------- RX dispatch ----------
+  // Shared front end: validates the frame once, then routes it through a 256-entry
+  // constexpr table keyed by command byte (see make_dispatch_table_()).
   void handle_frame_(const uint8_t *data, size_t len) {
-    // Petkit frame min length: 9 bytes (FA FC FD + cmd/type/seq/len/start + FB)
-    if (len < 9) return;
-    if (!(data[0] == 0xFA && data[1] == 0xFC && data[2] == 0xFD)) return;
-    if (data[len - 1] != 0xFB) return;
-  
-    const uint8_t cmd = data[3];
-  
-    // ----- CMD213: device identifiers -----
-    if (cmd == 0xD5) {  // 213
-      auto info = petkit_parse_cmd213_(data, len);
-      if (info.ok) {
-        this->device_id_bytes_ = info.device_id_bytes;
-        this->device_id_int_ = info.device_id_int;
-        this->serial_ = info.serial;
-        if (this->serial_text_ && !this->serial_.empty()) {
-          this->serial_text_->publish_state(this->serial_);
-        }
-        this->have_identifiers_ = true;
-  
-        ESP_LOGI(TAG, "CMD213 parsed: device_id=%llu serial=%s",
-                 (unsigned long long) this->device_id_int_,
-                 this->serial_.c_str());
-        // // schedule CMD210 1.5s after identifiers
-        // this->schedule_cmd210_ = true;
-        // this->cmd210_at_ms_ = millis() + 1500;
-        // this->cmd210_sent_after_213_ = false;
-        // ESP_LOGD(TAG, "Scheduling CMD210 in 1500ms after CMD213");
-        this->compute_secret_from_device_id_();
-        this->init_stage_ = INIT_SEND_73;
-        this->init_at_ms_ = millis() + 1500;
-        ESP_LOGD(TAG, "Starting init chain: CMD73 in 1500ms");
+    capture_.record(millis(), PETKIT_CAPTURE_RX, data, len);
 
-      } else {
-        ESP_LOGW(TAG, "CMD213 received but parse failed (len=%u)", (unsigned) len);
-      }
+    PetkitFrame f;
+    if (!petkit_decode_frame_(data, len, f)) {
+      ESP_LOGD(TAG, "Invalid frame dropped (len=%u)", (unsigned) len);
+      metrics_.on_invalid_frame();
       return;
     }
-  
-    // ----- CMD230 or other notify frames can be handled here too -----
-  
-    // ----- CMD0xE6 (your existing state/config frame) -----
-    // if (cmd == 0xE6 && len >= 24) {
-    //   last_power_ = data[8];
-    //   last_mode_ = data[9];
-    //
-    //   if (power_) power_->publish_state(data[8]);
-    //   if (mode_) mode_->publish_state(data[9]);
-    //   if (power_sw_) power_sw_->publish_state(data[8] != 0);
-    //   if (mode_sel_) mode_sel_->publish_state((data[9] == 2) ? "smart" : "normal");
-    //
-    //   if (filter_percent_ && len > 18) filter_percent_->publish_state(data[18]);
-    //
-    //   // settings part
-    //   if (len >= 38) {
-    //     if (light_sw_) light_sw_->publish_state(data[26] != 0);
-    //     if (dnd_sw_) dnd_sw_->publish_state(data[32] != 0);
-    //     if (brightness_num_) brightness_num_->publish_state((float) data[27]);
-    //
-    //     last_config_payload_.assign({
-    //       data[24], data[25], data[26], data[27],
-    //       data[28], data[29], data[30], data[31],
-    //       data[32], data[33], data[34], data[35], data[36]
-    //     });
-    //
-    //     uint16_t ls = u16_be_(&data[28]);
-    //     uint16_t le = u16_be_(&data[30]);
-    //     uint16_t ds = u16_be_(&data[33]);
-    //     uint16_t de = u16_be_(&data[35]);
-    //     (void) ls; (void) le; (void) ds; (void) de;
-    //   }
-    //   return;
-    // }
-    if (cmd == 0xE6 && len >= 38) {
-      const uint8_t power = data[8];
-      const uint8_t mode  = data[9];
-    
-      const uint8_t night_dnd = data[10];
-      const uint8_t breakdown_warn = data[11];
-      const uint8_t lack_warn = data[12];
-      const uint8_t filter_warn = data[13];
-    
-      const uint32_t pump_runtime =
-          ((uint32_t)data[14] << 24) | ((uint32_t)data[15] << 16) | ((uint32_t)data[16] << 8) | (uint32_t)data[17];
-    
-      const uint8_t filter_percent = data[18];
-      const uint8_t run_status = data[19];
-    
-      const uint32_t today_runtime =
-          ((uint32_t)data[20] << 24) | ((uint32_t)data[21] << 16) | ((uint32_t)data[22] << 8) | (uint32_t)data[23];
-
-      last_power_ = power;
-      last_mode_ = mode;
-      last_filter_percent_raw_ = filter_percent;
-
-    
-      // --- publish base state ---
-      if (power_) power_->publish_state(power);
-      if (mode_) mode_->publish_state(mode);
-    
-      if (power_sw_) power_sw_->publish_state(power != 0);
-      if (mode_sel_) mode_sel_->publish_state((mode == 2) ? "smart" : "normal");
-    
-      if (filter_percent_) filter_percent_->publish_state(filter_percent);
-    
-      // --- publish warnings / flags (if you have the sensors) ---
-      if (is_night_dnd_) is_night_dnd_->publish_state(night_dnd);
-      if (lack_warning_bin_) lack_warning_bin_->publish_state(lack_warn != 0);
-      if (breakdown_warning_bin_) breakdown_warning_bin_->publish_state(breakdown_warn != 0);
-      if (filter_warning_bin_) filter_warning_bin_->publish_state(filter_warn != 0);
-
-    
-      if (run_status_) run_status_->publish_state(run_status);
-    
-      // --- runtimes ---
-      if (water_pump_runtime_seconds_) water_pump_runtime_seconds_->publish_state((float) pump_runtime);
-      if (today_pump_runtime_seconds_) today_pump_runtime_seconds_->publish_state((float) today_runtime);
-
-      // Optional extended fields on some firmwares.
-      if (today_purified_water_times_) {
-        if (len > 37) {
-          today_purified_water_times_->publish_state((float) data[37]);
-        } else {
-          today_purified_water_times_->publish_state(NAN);
-        }
+    metrics_.rx_frames++;
+
+    const PetkitCmdEntry &e = dispatch_entry_(f.cmd);
+    if (e.handler == nullptr) {
+      ESP_LOGD(TAG, "Unhandled cmd=0x%02X len=%u", f.cmd, (unsigned) len);
+      metrics_.on_unhandled(f.cmd);
+      return;
+    }
+    if ((e.type != PETKIT_ANY_TYPE && f.type != e.type) || f.data_len < e.min_len || f.data_len > e.max_len) {
+      ESP_LOGW(TAG, "%s: unexpected frame (type=%u data_len=%u)", e.name, f.type, f.data_len);
+      metrics_.on_parse_error(f.cmd);
+      return;
+    }
+    (this->*e.handler)(f);
+
+    if (f.type == PETKIT_TYPE_RESPONSE) {
+      PetkitInflight *req = inflight_.match(f.seq, f.cmd);
+      if (req != nullptr) {
+        if (read_template_(f.cmd) == nullptr) write_acks_seen_ = true;
+        metrics_.on_reply(f.cmd, millis() - req->sent_ms);
+        // a NAK (ACK status != 1) is a reply, but the write did not take
+        const bool nak = e.handler == &PetkitFountain::on_ack_ && f.data[0] != 1;
+        finish_inflight_(*req, !nak);
+        process_tx_queue_();
       }
-      if (today_energy_kwh_) {
-        if (len > 41) {
-          const uint32_t energy_raw =
-              ((uint32_t)data[38] << 24) | ((uint32_t)data[39] << 16) | ((uint32_t)data[40] << 8) |
-              (uint32_t)data[41];
-          today_energy_kwh_->publish_state((float) energy_raw);
-        } else {
-          today_energy_kwh_->publish_state(NAN);
+    }
+  }
+
+  static const PetkitCmdEntry &dispatch_entry_(uint8_t cmd);
+  static constexpr std::array<PetkitCmdEntry, 256> make_dispatch_table_();
+
+  // ----- CMD213: device identifiers -----
+  void on_identifiers_(const PetkitFrame &f) {
+    auto info = petkit_parse_cmd213_(f);
+    if (!info.ok) return;
+
+    const bool same = this->have_identifiers_ && info.device_id_bytes == this->device_id_bytes_;
+    if (this->identity_verify_pending_) {
+      this->identity_verify_pending_ = false;
+      if (same) {
+        ESP_LOGD(TAG, "CMD213: cached identity confirmed");
+        this->identity_from_cache_ = false;
+        if (info.serial != this->serial_) {
+          this->serial_ = info.serial;
+          publish_serial_();
+          save_identity_cache_();
         }
+        return;
       }
-    
-      // --- settings block ---
-      const uint8_t smart_on  = data[24];
-      const uint8_t smart_off = data[25];
-      const uint8_t light_sw  = data[26];
-      const uint8_t brightness = data[27];
-    
-      const uint16_t light_start = ((uint16_t)data[28] << 8) | data[29];
-      const uint16_t light_end   = ((uint16_t)data[30] << 8) | data[31];
-    
-      const uint8_t dnd_sw = data[32];
-      const uint16_t dnd_start = ((uint16_t)data[33] << 8) | data[34];
-      const uint16_t dnd_end   = ((uint16_t)data[35] << 8) | data[36];
-
-      last_smart_on_min_  = smart_on;
-      last_smart_off_min_ = smart_off;
-      publish_filter_remaining_days_();
-
-    
-      if (smart_working_time_) smart_working_time_->publish_state(smart_on);
-      if (smart_sleep_time_) smart_sleep_time_->publish_state(smart_off);
-    
-      // Diese beiden sind bei dir aktuell als "Sensor" implementiert – daher publish_state() ok.
-      // Wenn du später echte ESPHome switches/numbers draus machst, musst du die jeweiligen publish APIs nutzen.
-      if (light_switch_) light_switch_->publish_state(light_sw);
-      if (light_brightness_) light_brightness_->publish_state(brightness);
-    
-      if (light_schedule_start_min_) light_schedule_start_min_->publish_state(light_start);
-      if (light_schedule_end_min_)   light_schedule_end_min_->publish_state(light_end);
-    
-      if (dnd_switch_) dnd_switch_->publish_state(dnd_sw);
-      if (dnd_start_min_) dnd_start_min_->publish_state(dnd_start);
-      if (dnd_end_min_)   dnd_end_min_->publish_state(dnd_end);
-    
-      ESP_LOGD(TAG, "entities: pwr_sw=%p light_sw=%p dnd_sw=%p mode_sel=%p bright=%p",
-         (void*) power_sw_, (void*) light_sw_, (void*) dnd_sw_, (void*) mode_sel_, (void*) brightness_num_);
+      ESP_LOGW(TAG, "CMD213: device identity differs from cache; re-initialising");
+    }
+    this->identity_from_cache_ = false;
+
+    this->device_id_bytes_ = info.device_id_bytes;
+    this->device_id_int_ = info.device_id_int;
+    this->serial_ = info.serial;
+    publish_serial_();
+    this->have_identifiers_ = true;
+
+    ESP_LOGI(TAG, "CMD213 parsed: device_id=%llu serial=%s",
+             (unsigned long long) this->device_id_int_,
+             this->serial_.c_str());
+    this->compute_secret_from_device_id_();
+    save_identity_cache_();
+    this->start_init_chain_();
+  }
+
+  void publish_serial_() {
+    if (serial_text_ && !serial_.empty() && serial_text_->state != serial_.c_str()) serial_text_->publish_state(serial_.c_str());
+  }
+
+  void start_init_chain_() {
+    this->init_stage_ = INIT_SEND_73;
+    this->init_at_ms_ = millis() + INIT_START_DELAY_MS;
+    this->init_wait_ack_ = 0;
+    this->init_retries_ = 0;
+    ESP_LOGD(TAG, "Starting init chain: CMD73 in %ums", (unsigned) INIT_START_DELAY_MS);
+  }
+
+  // ----- identity cache -----
+  // device_id/secret/serial/handles in preferences, keyed by the peer MAC; lets a reconnect
+  // (or a boot) skip the CMD213 round trip. Written only when something changed.
+  struct IdentityCache {
+    uint64_t address;
+    uint64_t device_id_int;
+    uint32_t version;
+    uint16_t notify_handle;
+    uint16_t write_handle;
+    uint8_t device_id[6];
+    uint8_t device_id8[8];
+    uint8_t secret[8];
+    char serial[26];
+  };
+  // no padding: save_identity_cache_() compares with memcmp
+  static_assert(sizeof(IdentityCache) == 8 + 8 + 4 + 2 + 2 + 6 + 8 + 8 + 26, "IdentityCache has padding");
+  static constexpr uint32_t IDENTITY_CACHE_VERSION = 1;
+  IdentityCache identity_cache_{};  // last loaded/saved
+
+  void load_identity_cache_(uint64_t address) {
+    char key[32];
+    snprintf(key, sizeof(key), "petkit_id_%012llX", (unsigned long long) address);
+    identity_pref_ = global_preferences->make_preference<IdentityCache>(fnv1_hash(key));
+
+    IdentityCache c{};
+    if (!identity_pref_.load(&c) || c.version != IDENTITY_CACHE_VERSION || c.address != address) return;
+    identity_cache_ = c;
+    identity_cache_valid_ = true;
+
+    std::copy(std::begin(c.device_id), std::end(c.device_id), device_id_bytes_.begin());
+    device_id_int_ = c.device_id_int;
+    std::copy(std::begin(c.device_id8), std::end(c.device_id8), device_id8_.begin());
+    std::copy(std::begin(c.secret), std::end(c.secret), secret_.begin());
+    serial_.assign(c.serial, strnlen(c.serial, sizeof(c.serial) - 1));
+    have_identifiers_ = true;
+    have_secret_ = true;
+    identity_from_cache_ = true;
+    publish_serial_();
+    ESP_LOGI(TAG, "Identity loaded from flash: device_id=%llu serial=%s", (unsigned long long) device_id_int_,
+             serial_.c_str());
+  }
+
+  void save_identity_cache_() {
+    auto *parent = this->parent();
+    if (!parent || !have_secret_ || !have_identifiers_) return;
+
+    IdentityCache c{};
+    c.version = IDENTITY_CACHE_VERSION;
+    c.address = parent->get_address();
+    c.device_id_int = device_id_int_;
+    std::copy(device_id_bytes_.begin(), device_id_bytes_.end(), c.device_id);
+    std::copy(device_id8_.begin(), device_id8_.end(), c.device_id8);
+    std::copy(secret_.begin(), secret_.end(), c.secret);
+    memcpy(c.serial, serial_.c_str(), serial_.size());
+    c.notify_handle = notify_handle_;
+    c.write_handle = write_handle_;
+    if (identity_cache_valid_ && memcmp(&c, &identity_cache_, sizeof(c)) == 0) return;
+
+    if (identity_pref_.save(&c)) {
+      identity_cache_ = c;
+      identity_cache_valid_ = true;
+      ESP_LOGD(TAG, "Identity cache saved");
+    }
+  }
+
+  void invalidate_identity_cache_() {
+    if (!identity_cache_valid_) return;
+    IdentityCache c{};
+    identity_pref_.save(&c);
+    identity_cache_ = c;
+    identity_cache_valid_ = false;
+  }
+
+  // ----- config baseline cache -----
+  // Lets the first CMD221 after boot go out without a CMD211 round trip. The next D3
+  // replaces the baseline; the device stays authoritative.
+  struct ConfigCache {
+    uint32_t version;
+    uint8_t cfg[PETKIT_CONFIG_LEN];
+    uint8_t reserved[3];
+  };
+  static_assert(sizeof(ConfigCache) == 4 + PETKIT_CONFIG_LEN + 3, "ConfigCache has padding");
+  static constexpr uint32_t CONFIG_CACHE_VERSION = 1;
+
+  void load_config_cache_(uint64_t address) {
+    char key[32];
+    snprintf(key, sizeof(key), "petkit_cfg_%012llX", (unsigned long long) address);
+    config_pref_ = global_preferences->make_preference<ConfigCache>(fnv1_hash(key));
+
+    ConfigCache c{};
+    if (!config_pref_.load(&c) || c.version != CONFIG_CACHE_VERSION) return;
+    std::copy(std::begin(c.cfg), std::end(c.cfg), cfg_saved_.begin());
+    cfg_saved_valid_ = true;
+    std::copy(std::begin(c.cfg), std::end(c.cfg), last_config_payload_.begin());
+    have_config_payload_ = true;
+    cfg_baseline_from_flash_ = true;
+    last_smart_on_min_ = c.cfg[0];
+    last_smart_off_min_ = c.cfg[1];
+    ESP_LOGD(TAG, "Config baseline loaded from flash");
+  }
+
+  // D3 received: reconcile with the flash baseline and schedule a save if it changed.
+  void config_confirmed_() {
+    cfg_confirmed_ = last_config_payload_;
+    const bool same = cfg_saved_valid_ && cfg_confirmed_ == cfg_saved_;
+    if (cfg_baseline_from_flash_ && !same) ESP_LOGD(TAG, "Device config differs from the flash baseline");
+    cfg_baseline_from_flash_ = false;
+    if (!same) cfg_save_pending_ = true;
+  }
 
+  // Called from loop(); at most one flash write per CONFIG_SAVE_MIN_INTERVAL_MS.
+  void save_config_cache_() {
+    const uint32_t now = millis();
+    if (cfg_saved_this_boot_ && (now - cfg_last_save_ms_) < CONFIG_SAVE_MIN_INTERVAL_MS) return;
+    cfg_save_pending_ = false;
+    if (cfg_saved_valid_ && cfg_confirmed_ == cfg_saved_) return;
+
+    ConfigCache c{};
+    c.version = CONFIG_CACHE_VERSION;
+    std::copy(cfg_confirmed_.begin(), cfg_confirmed_.end(), c.cfg);
+    cfg_saved_this_boot_ = true;
+    cfg_last_save_ms_ = now;
+    if (config_pref_.save(&c)) {
+      cfg_saved_ = cfg_confirmed_;
+      cfg_saved_valid_ = true;
+      ESP_LOGD(TAG, "Config baseline saved");
+    }
+  }
+
+  // ----- usage accounting -----
+  struct UsageCache {
+    uint32_t version;
+    uint32_t day;
+    uint32_t resets;
+    PetkitUsageTotals lifetime;
+    PetkitUsageTotals today;
+    uint32_t last_pump_s;
+    uint32_t last_energy_raw;
+    uint8_t last_cycles;
+    uint8_t last_flags;  // bit0 has_last, bit1 has_cycles, bit2 has_energy
+    uint8_t reserved[2];
+  };
+  static_assert(sizeof(UsageCache) == 4 * 3 + 2 * sizeof(PetkitUsageTotals) + 4 * 2 + 4, "UsageCache has padding");
+  static constexpr uint32_t USAGE_CACHE_VERSION = 1;
+
+  // local date as YYYYMMDD, 0 while the clock is not set
+  static uint32_t local_day_key_() {
+    const time_t t = ::time(nullptr);
+    struct tm tm;
+    if (localtime_r(&t, &tm) == nullptr || tm.tm_year < 120) return 0;
+    return (uint32_t) ((tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday);
+  }
+
+  void account_usage_(const PetkitStateE6 &st) {
+    PetkitUsageSample s;
+    s.pump_s = st.today_runtime;
+    s.cycles = st.today_purified_times;
+    s.has_cycles = st.has_purified_times;
+    s.energy_raw = st.energy_raw;
+    s.has_energy = st.has_energy;
+
+    const uint32_t now = millis();
+    const uint32_t elapsed_s = usage_last_sample_ms_ == 0 ? 0 : std::max<uint32_t>(1, (now - usage_last_sample_ms_) / 1000);
+    usage_last_sample_ms_ = now;
+    const uint32_t resets = usage_.resets;
+    if (usage_.add(s, local_day_key_(), elapsed_s)) usage_save_pending_ = true;
+    if (usage_.resets != resets) ESP_LOGD(TAG, "Device restarted its daily counters");
+    publish_usage_();
+  }
+
+  void publish_usage_() {
+    if (!usage_.has_last) return;
+    publish_field_(FIELD_TOTAL_PUMP_RUNTIME, (float) usage_.lifetime.pump_s);
+    publish_field_(FIELD_TOTAL_PURIFIED, (float) usage_.lifetime.cycles);
+    publish_field_(FIELD_TOTAL_ENERGY, usage_.lifetime.energy_raw * energy_scale_);
+    publish_field_(FIELD_DAILY_PUMP_RUNTIME, (float) usage_.today.pump_s);
+    publish_field_(FIELD_DAILY_PURIFIED, (float) usage_.today.cycles);
+    publish_field_(FIELD_DAILY_ENERGY, usage_.today.energy_raw * energy_scale_);
+  }
+
+  void load_usage_(uint64_t address) {
+    char key[32];
+    snprintf(key, sizeof(key), "petkit_use_%012llX", (unsigned long long) address);
+    usage_pref_ = global_preferences->make_preference<UsageCache>(fnv1_hash(key));
+
+    UsageCache c{};
+    if (!usage_pref_.load(&c) || c.version != USAGE_CACHE_VERSION) return;
+    usage_.day = c.day;
+    usage_.resets = c.resets;
+    usage_.lifetime = c.lifetime;
+    usage_.today = c.today;
+    usage_.last.pump_s = c.last_pump_s;
+    usage_.last.energy_raw = c.last_energy_raw;
+    usage_.last.cycles = c.last_cycles;
+    usage_.has_last = c.last_flags & 1;
+    usage_.last.has_cycles = c.last_flags & 2;
+    usage_.last.has_energy = c.last_flags & 4;
+    ESP_LOGD(TAG, "Usage totals loaded: pump=%us cycles=%u energy=%u", (unsigned) c.lifetime.pump_s,
+             (unsigned) c.lifetime.cycles, (unsigned) c.lifetime.energy_raw);
+  }
+
+  // Throttled like the config baseline; `force` for day rollovers.
+  void save_usage_(bool force) {
+    const uint32_t now = millis();
+    if (!force && usage_saved_this_boot_ && (now - usage_last_save_ms_) < USAGE_SAVE_MIN_INTERVAL_MS) {
+      usage_save_pending_ = true;
       return;
     }
+    usage_save_pending_ = false;
+    UsageCache c{};
+    c.version = USAGE_CACHE_VERSION;
+    c.day = usage_.day;
+    c.resets = usage_.resets;
+    c.lifetime = usage_.lifetime;
+    c.today = usage_.today;
+    c.last_pump_s = usage_.last.pump_s;
+    c.last_energy_raw = usage_.last.energy_raw;
+    c.last_cycles = usage_.last.cycles;
+    c.last_flags = (usage_.has_last ? 1 : 0) | (usage_.last.has_cycles ? 2 : 0) | (usage_.last.has_energy ? 4 : 0);
+    usage_saved_this_boot_ = true;
+    usage_last_save_ms_ = now;
+    usage_pref_.save(&c);
+  }
+
+  // ----- filter life estimate -----
+  struct FilterCache {
+    uint32_t version;
+    uint32_t reserved;
+    PetkitFilterEstimator::State st;
+  };
+  static_assert(sizeof(PetkitFilterEstimator::State) == 5 * 8 + 5 * 4 + 4, "State has padding");
+  static_assert(sizeof(FilterCache) == 8 + sizeof(PetkitFilterEstimator::State), "FilterCache has padding");
+  static constexpr uint32_t FILTER_CACHE_VERSION = 1;
+  static constexpr time_t CLOCK_VALID_AFTER = 1577836800;  // 2020-01-01
+
+  void load_filter_estimate_(uint64_t address) {
+    char key[32];
+    snprintf(key, sizeof(key), "petkit_flt_%012llX", (unsigned long long) address);
+    filter_pref_ = global_preferences->make_preference<FilterCache>(fnv1_hash(key));
+    FilterCache c{};
+    if (!filter_pref_.load(&c) || c.version != FILTER_CACHE_VERSION) return;
+    filter_est_.state = c.st;
+    ESP_LOGD(TAG, "Filter estimate loaded: %u point(s)", (unsigned) c.st.n);
+  }
 
+  void sample_filter_(uint32_t pump_runtime_s, uint8_t percent) {
+    const time_t now = ::time(nullptr);
+    if (now < CLOCK_VALID_AFTER || percent > 100) return;
+    if (filter_est_.add((uint32_t) now, pump_runtime_s, percent)) filter_save_pending_ = true;
+  }
 
-    // Generic ACKs (format: FA FC FD <cmd> 02 <seq> 01 00 <status> FB)
-    if (cmd == 0x49 || cmd == 0x56 || cmd == 0x54 || cmd == 0xDC || cmd == 0xDD) {
-      auto ack = petkit_parse_ack_(data, len);
-      if (ack.ok) {
-        if (ack.cmd == 0x49) {
-          ESP_LOGI(TAG, "CMD73 ACK: seq=%u status=%u", ack.seq, ack.value);
-          have_init_ = (ack.value == 1);
-        } else if (ack.cmd == 0x56) {
-          ESP_LOGI(TAG, "CMD86 ACK: seq=%u status=%u", ack.seq, ack.value);
-          have_sync_ = (ack.value == 1);
-        } else if (ack.cmd == 0x54) {
-          ESP_LOGI(TAG, "CMD84 ACK: seq=%u status=%u", ack.seq, ack.value);
-          have_time_ = (ack.value == 1);
-        } else if (ack.cmd == 0xDC) {
-          ESP_LOGI(TAG, "CMD220 ACK: seq=%u status=%u", ack.seq, ack.value);
-        } else if (ack.cmd == 0xDD) {
-          ESP_LOGI(TAG, "CMD221 ACK: seq=%u status=%u", ack.seq, ack.value);
-        }
-      } else {
-        ESP_LOGW(TAG, "ACK parse failed cmd=0x%02X len=%u", cmd, (unsigned) len);
+  // from loop(): keeps the preference write (and its copy) out of the BLE handler
+  void save_filter_estimate_() {
+    filter_save_pending_ = false;
+    FilterCache c{};
+    c.version = FILTER_CACHE_VERSION;
+    c.st = filter_est_.state;
+    filter_pref_.save(&c);
+  }
+
+  // "YYYY-MM-DD (YYYY-MM-DD..YYYY-MM-DD)" in local time
+  void publish_filter_replacement_(const PetkitFilterEstimator::Estimate &est) {
+    if (!filter_replacement_text_) return;
+    const time_t now = ::time(nullptr);
+    if (now < CLOCK_VALID_AFTER) return;
+    auto date = [now](float days, char *out) {
+      const time_t t = now + (time_t) (days * 86400.0f);
+      struct tm tm;
+      localtime_r(&t, &tm);
+      strftime(out, 11, "%Y-%m-%d", &tm);
+    };
+    char mid[11], lo[11], hi[11], buf[40];
+    date(est.days, mid);
+    date(est.days_low, lo);
+    date(est.days_high, hi);
+    snprintf(buf, sizeof(buf), "%s (%s..%s)", mid, lo, hi);
+    if (filter_replacement_text_->state != buf) filter_replacement_text_->publish_state(buf);
+  }
+
+  // ----- init chain -----
+  void init_send_(InitStage stage) {
+    const uint32_t now = millis();
+    switch (stage) {
+      case INIT_SEND_73:
+        this->enqueue_cmd73_();
+        ESP_LOGD(TAG, "Init chain: sent CMD73");
+        this->init_expect_(stage, 0x49, INIT_SEND_86, now + 1500);
+        break;
+
+      case INIT_SEND_86:
+        this->enqueue_cmd86_();
+        ESP_LOGD(TAG, "Init chain: sent CMD86");
+        this->init_expect_(stage, 0x56, INIT_SEND_84, now + 750);
+        break;
+
+      case INIT_SEND_84: {
+        // CMD84 payload: Utils.time_in_bytes() equivalent: [0, sec>>24, sec>>16, sec>>8, sec, 13]
+        // Reference time: 2000-01-01 UTC.
+        const auto t = this->build_time_bytes_();
+        this->enqueue_(84, 1, t.data(), t.size());
+        ESP_LOGD(TAG, "Init chain: sent CMD84");
+        this->init_expect_(stage, 0x54, INIT_SEND_210, now + 750);
+        break;
       }
+
+      case INIT_SEND_210:
+        this->enqueue_read_(210);
+        ESP_LOGD(TAG, "Init chain: sent CMD210");
+        this->init_stage_ = INIT_SEND_211;
+        break;
+
+      case INIT_SEND_211:
+        this->enqueue_read_(211);
+        ESP_LOGD(TAG, "Init chain: sent CMD211");
+        this->init_stage_ = INIT_NONE;
+        this->session_ready_ = true;
+        if (this->identity_from_cache_ && !this->identity_verify_pending_) {
+          this->identity_verify_pending_ = true;
+          this->enqueue_read_(213);
+        }
+        break;
+
+      default:
+        this->init_stage_ = INIT_NONE;
+        break;
+    }
+  }
+
+  void init_expect_(InitStage sent, uint8_t ack_cmd, InitStage next, uint32_t timeout_at) {
+    this->init_wait_stage_ = sent;
+    this->init_wait_ack_ = ack_cmd;
+    this->init_nak_ = false;
+    this->init_stage_ = next;
+    this->init_at_ms_ = timeout_at;
+  }
+
+  // Timeouts are retried by the in-flight table; a NAK resends the step here.
+  bool init_should_retry_() {
+    if (!this->init_nak_ || this->init_retries_ >= INIT_MAX_RETRIES) {
+      ESP_LOGD(TAG, "Init chain: no ACK 0x%02X, continuing", this->init_wait_ack_);
+      return false;
+    }
+    this->init_nak_ = false;
+    this->init_retries_++;
+    ESP_LOGW(TAG, "Init chain: NAK 0x%02X, retry %u/%u", this->init_wait_ack_, this->init_retries_,
+             INIT_MAX_RETRIES);
+    return true;
+  }
+
+  void init_on_ack_(uint8_t ack_cmd, uint8_t status) {
+    if (this->init_stage_ == INIT_NONE || this->init_wait_ack_ != ack_cmd) return;
+    this->init_nak_ = status != 1;
+    if (this->init_nak_ && ack_cmd == 0x49 && this->identity_from_cache_) {
+      // secret from flash rejected: forget it and start over with CMD213
+      ESP_LOGW(TAG, "CMD73 rejected with cached identity; re-reading CMD213");
+      this->invalidate_identity_cache_();
+      this->identity_from_cache_ = false;
+      this->have_secret_ = false;
+      this->init_stage_ = INIT_NONE;
+      this->init_wait_ack_ = 0;
+      this->enqueue_read_(213);
       return;
     }
+    if (status == 1) {
+      this->init_wait_ack_ = 0;
+      this->init_retries_ = 0;
+      this->init_at_ms_ = millis();
+    } else {
+      this->init_at_ms_ = millis() + INIT_RETRY_BACKOFF_MS;
+    }
+  }
 
+  // ----- CMD0xE6: periodic state + settings push -----
+  void on_state_push_(const PetkitFrame &f) {
+    const auto st = petkit_parse_state_e6_t_<PetkitModelProfile>(f);
+    if (!st.ok) {
+      ESP_LOGW(TAG, "E6 (len=%u) does not fit model profile %s", (unsigned) f.data_len, PetkitModelProfile::NAME);
+      metrics_.on_parse_error(f.cmd);
+      return;
+    }
+#ifndef PETKIT_MODEL_PROFILE
+    report_detected_profile_(f.data_len);
+#endif
+    mark_state_seen_();
+
+    last_power_ = st.power;
+    last_mode_ = st.mode;
+    last_filter_percent_raw_ = st.filter_percent;
+    track_poll_state_(st);
+
+    // --- publish base state ---
+    publish_field_(FIELD_POWER, st.power);
+    publish_field_(FIELD_MODE, st.mode);
+    publish_field_(FIELD_FILTER_PERCENT, st.filter_percent);
+
+    // --- publish warnings / flags ---
+    publish_field_(FIELD_NIGHT_DND, st.night_dnd);
+    publish_field_(FIELD_LACK_WARN, st.lack_warn);
+    publish_field_(FIELD_BREAKDOWN_WARN, st.breakdown_warn);
+    publish_field_(FIELD_FILTER_WARN, st.filter_warn);
+
+    publish_field_(FIELD_RUN_STATUS, st.run_status);
+
+    // --- runtimes ---
+    publish_field_(FIELD_PUMP_RUNTIME, (float) st.pump_runtime);
+    publish_field_(FIELD_TODAY_PUMP_RUNTIME, (float) st.today_runtime);
+
+    // Optional extended fields on some firmwares.
+    publish_field_(FIELD_TODAY_PURIFIED, st.has_purified_times ? (float) st.today_purified_times : NAN);
+    publish_field_(FIELD_TODAY_ENERGY, st.has_energy ? (float) st.energy_raw : NAN);
+    account_usage_(st);
+    sample_filter_(st.pump_runtime, st.filter_percent);
+
+    // --- settings block ---
+    const auto &cfg = st.config;
+
+    last_smart_on_min_  = cfg.smart_on;
+    last_smart_off_min_ = cfg.smart_off;
+    publish_filter_remaining_days_();
 
+    publish_config_(cfg);
+  }
 
-    if (cmd == 0xD2) {  // response to CMD210
-      auto st = petkit_parse_state_d2_(data, len);
-      if (st.ok) {
-        ESP_LOGI(TAG, "CMD210->D2: power=%u mode=%u dnd=%u warn(break=%u lack=%u filter=%u) filter=%u run=%u",
-                 st.power, st.mode, st.night_dnd, st.breakdown_warn, st.lack_warn, st.filter_warn,
-                 st.filter_percent, st.run_status);
-        last_power_ = st.power;
-        last_mode_ = st.mode;
-        last_filter_percent_raw_ = st.filter_percent;
-        publish_filter_remaining_days_();
-
-    
-        // publish to sensors if you have them
-        if (power_) power_->publish_state(st.power);
-        if (mode_) mode_->publish_state(st.mode);
-        if (power_sw_) power_sw_->publish_state(st.power != 0);
-        if (mode_sel_) mode_sel_->publish_state((st.mode == 2) ? "smart" : "normal");
-    
-        if (is_night_dnd_) is_night_dnd_->publish_state(st.night_dnd);
-        if (lack_warning_bin_) lack_warning_bin_->publish_state(st.lack_warn != 0);
-        if (breakdown_warning_bin_) breakdown_warning_bin_->publish_state(st.breakdown_warn != 0);
-        if (filter_warning_bin_) filter_warning_bin_->publish_state(st.filter_warn != 0);
-
-    
-        if (filter_percent_) filter_percent_->publish_state(st.filter_percent);
-        if (run_status_) run_status_->publish_state(st.run_status);
-      } else {
-        ESP_LOGW(TAG, "CMD0xD2 parse failed (len=%u)", (unsigned) len);
-      }
+#ifndef PETKIT_MODEL_PROFILE
+  // auto profile: name the fixed profile whose layout matches the E6 length seen.
+  // 30..33 bytes carry the purified byte but no energy; no fixed profile reads that.
+  void report_detected_profile_(uint8_t e6_len) {
+    if (e6_len == profile_seen_e6_len_) return;
+    profile_seen_e6_len_ = e6_len;
+    const char *match = petkit_profile_for_e6_len_(e6_len);
+    if (match == nullptr) {
+      ESP_LOGI(TAG, "E6 is %u bytes: partial tail, no fixed model profile matches (keep model: auto)",
+               (unsigned) e6_len);
+    } else if (e6_len < PetkitProfileCTW2::E6_MIN_LEN) {
+      ESP_LOGI(TAG, "E6 is %u bytes: no tail, layout of model profile '%s' (unverified, check the values before "
+               "pinning it)", (unsigned) e6_len, match);
+    } else {
+      ESP_LOGI(TAG, "E6 is %u bytes: layout matches model profile '%s' (set model: %s to pin it)", (unsigned) e6_len,
+               match, match);
+    }
+    if (profile_text_) {
+      char buf[40];
+      snprintf(buf, sizeof(buf), "auto: %s%s (E6 %u)", match ? match : "partial tail",
+               match && e6_len < PetkitProfileCTW2::E6_MIN_LEN ? " unverified" : "", (unsigned) e6_len);
+      profile_text_->publish_state(buf);
+    }
+  }
+#endif
+
+  void mark_state_seen_() {
+    state_seen_ = true;
+    last_state_ms_ = millis();
+    if (first_state_pending_) {
+      first_state_pending_ = false;
+      metrics_.first_state_ms = last_state_ms_ - link_up_since_ms_;
+    }
+  }
+
+  // Allocation totals before a handler. Without the allocator hook (only linked in when an
+  // allocation sensor is configured) the counts stay 0 and only the free heap is sampled.
+  PetkitAllocCount heap_probe_begin_() const {
+#ifdef USE_PETKIT_ALLOC_PROBE
+    if (heap_probe_) return petkit_alloc_probe_begin();
+#endif
+    return {};
+  }
+
+  // heap_caps_get_free_size() is a counter read; the largest block (a heap walk on older IDF)
+  // is only sampled after a handler allocated.
+  void heap_probe_end_(PetkitHeapStats::Side &side, const char *dir, uint8_t cmd, const PetkitAllocCount &before) {
+    if (!heap_probe_) return;
+#ifdef USE_PETKIT_ALLOC_PROBE
+    const PetkitAllocCount after = petkit_alloc_probe_totals();
+#else
+    const PetkitAllocCount after = before;
+#endif
+    const size_t free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    heap_.sample_free(free);
+    const uint32_t allocs = PetkitHeapStats::account(side, before, after);
+    if (allocs == 0) return;
+    heap_.sample_largest(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+    ESP_LOGD(TAG, "Heap: %s cmd=0x%02X made %u allocation(s), %u bytes (free %u)", dir, (unsigned) cmd,
+             (unsigned) allocs, (unsigned) (after.bytes - before.bytes), (unsigned) free);
+  }
+
+  void publish_heap_() {
+    uint32_t low_free, low_largest;
+    heap_.take_low(heap_caps_get_free_size(MALLOC_CAP_8BIT), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+                   low_free, low_largest);
+    publish_field_(FIELD_HEAP_FREE, (float) low_free);
+    publish_field_(FIELD_HEAP_LARGEST_BLOCK, (float) low_largest);
+    publish_field_(FIELD_RX_HEAP_ALLOCS, (float) heap_.rx.allocs);
+    publish_field_(FIELD_RX_HEAP_BYTES, (float) heap_.rx.bytes);
+    publish_field_(FIELD_TX_HEAP_ALLOCS, (float) heap_.tx.allocs);
+    publish_field_(FIELD_TX_HEAP_BYTES, (float) heap_.tx.bytes);
+    ESP_LOGD(TAG,
+             "Heap: free>=%u largest>=%u rx %u allocs in %u frames (%u bytes), tx %u allocs in %u writes (%u bytes)",
+             (unsigned) low_free, (unsigned) low_largest, (unsigned) heap_.rx.allocs, (unsigned) heap_.rx.calls,
+             (unsigned) heap_.rx.bytes, (unsigned) heap_.tx.allocs, (unsigned) heap_.tx.calls,
+             (unsigned) heap_.tx.bytes);
+  }
+
+  void publish_metrics_() {
+    publish_field_(FIELD_TX_FRAMES, (float) metrics_.tx_frames);
+    publish_field_(FIELD_RX_FRAMES, (float) metrics_.rx_frames);
+    publish_field_(FIELD_RETRIES, (float) metrics_.retries);
+    publish_field_(FIELD_REPLY_TIMEOUTS, (float) metrics_.timeouts);
+    publish_field_(FIELD_PARSE_ERRORS, (float) (metrics_.parse_errors + framer_.get_dropped()));
+    publish_field_(FIELD_UNHANDLED_FRAMES, (float) metrics_.unhandled);
+    publish_field_(FIELD_TX_QUEUE_HIGH_WATER, (float) metrics_.queue_high_water);
+    if (metrics_.first_state_ms != 0) publish_field_(FIELD_FIRST_STATE_LATENCY, (float) metrics_.first_state_ms);
+    if (metrics_.rtt().n != 0) publish_field_(FIELD_REPLY_LATENCY, (float) metrics_.rtt().percentile(0.9f));
+
+    // the summary string is only built (and logged) for its text sensor
+    if (link_summary_text_ == nullptr) return;
+    char buf[256];
+    metrics_.format(buf, sizeof(buf));
+    ESP_LOGD(TAG, "Link: %s", buf);
+    if (link_summary_text_->state != buf) link_summary_text_->publish_state(buf);
+  }
+
+  // ----- adaptive polling -----
+  void poll_step_() {
+    // duty-cycled/managed sessions read state themselves
+    if (duty_cycling_() || managed_ || !session_ready_) return;
+    const uint32_t now = millis();
+
+    const float cap = std::max(poll_budget_ * POLL_BUDGET_WINDOW_MS, poll_rtt_ms_);  // room for one poll
+    if (poll_credit_ms_ < 0.0f) {
+      poll_credit_ms_ = cap;
+    } else {
+      poll_credit_ms_ = std::min(cap, poll_credit_ms_ + poll_budget_ * (float) (now - poll_credit_at_ms_));
+    }
+    poll_credit_at_ms_ = now;
+    if (poll_sent_ms_ != 0 && (now - poll_sent_ms_) >= 3 * REPLY_TIMEOUT_MS) poll_done_();  // unanswered
+
+    const uint32_t interval = poll_interval_();
+    if (poll_sent_ms_ != 0 || (now - last_state_ms_) + POLL_SLACK_MS < interval) return;  // pushes keep it fresh
+    if (poll_credit_ms_ < poll_rtt_ms_) {
+      ESP_LOGV(TAG, "Poll skipped: airtime budget used up");
       return;
     }
+    ESP_LOGV(TAG, "Poll (interval %us)", (unsigned) (interval / 1000));
+    poll_sent_ms_ = now;
+    cmd_get_state_();
+  }
 
-    if (cmd == 0xD3) {  // response to CMD211 (get_config)
-      auto cfg = petkit_parse_config_d3_(data, len);
-      if (!cfg.ok) {
-        ESP_LOGW(TAG, "CMD0xD3 parse failed (len=%u)", (unsigned) len);
-        return;
-      }
-      last_smart_on_min_  = cfg.smart_on;
-      last_smart_off_min_ = cfg.smart_off;
-      publish_filter_remaining_days_();
-
-    
-      // 1) baseline config setzen (damit CMD221 möglich wird)
-      last_config_payload_.assign({
-        cfg.smart_on,
-        cfg.smart_off,
-        cfg.light_sw,
-        cfg.brightness,
-        (uint8_t)((cfg.light_start >> 8) & 0xFF), (uint8_t)(cfg.light_start & 0xFF),
-        (uint8_t)((cfg.light_end   >> 8) & 0xFF), (uint8_t)(cfg.light_end   & 0xFF),
-        cfg.dnd_sw,
-        (uint8_t)((cfg.dnd_start  >> 8) & 0xFF), (uint8_t)(cfg.dnd_start  & 0xFF),
-        (uint8_t)((cfg.dnd_end    >> 8) & 0xFF), (uint8_t)(cfg.dnd_end    & 0xFF),
-      });
-    
-      ESP_LOGD(TAG,
-        "CMD211->D3 cfg: smart_on=%u smart_off=%u light=%u bright=%u ls=%u le=%u dnd=%u ds=%u de=%u",
-        cfg.smart_on, cfg.smart_off, cfg.light_sw, cfg.brightness,
-        cfg.light_start, cfg.light_end, cfg.dnd_sw, cfg.dnd_start, cfg.dnd_end
-      );
-    
-      // 2) Sensoren publishen (falls in YAML vorhanden)
-      if (smart_working_time_) smart_working_time_->publish_state(cfg.smart_on);
-      if (smart_on_num_)  smart_on_num_->publish_state((float) cfg.smart_on);
-      if (smart_off_num_) smart_off_num_->publish_state((float) cfg.smart_off);
-      if (smart_sleep_time_)   smart_sleep_time_->publish_state(cfg.smart_off);
-    
-      if (light_switch_)               light_switch_->publish_state(cfg.light_sw);
-      if (light_brightness_)           light_brightness_->publish_state(cfg.brightness);
-      if (light_schedule_start_min_)   light_schedule_start_min_->publish_state(cfg.light_start);
-      if (light_schedule_end_min_)     light_schedule_end_min_->publish_state(cfg.light_end);
-    
-      if (dnd_switch_) dnd_switch_->publish_state(cfg.dnd_sw);
-      if (dnd_start_min_) dnd_start_min_->publish_state(cfg.dnd_start);
-      if (dnd_end_min_)   dnd_end_min_->publish_state(cfg.dnd_end);
-    
-      // 3) ESPHome Entities publishen (Switch/Number)
-      if (light_sw_) light_sw_->publish_state(cfg.light_sw != 0);
-      if (dnd_sw_)   dnd_sw_->publish_state(cfg.dnd_sw != 0);
-    
-      if (brightness_num_) brightness_num_->publish_state((float) cfg.brightness);
-    
-      // 4) Time Number Entities publishen (die 4 Kind-Varianten)
-      for (auto *tn : time_nums_) {
-        if (!tn) continue;
-        switch (tn->get_kind()) {
-          case PetkitTimeNumber::LIGHT_START: tn->publish_state((float) cfg.light_start); break;
-          case PetkitTimeNumber::LIGHT_END:   tn->publish_state((float) cfg.light_end); break;
-          case PetkitTimeNumber::DND_START:   tn->publish_state((float) cfg.dnd_start); break;
-          case PetkitTimeNumber::DND_END:     tn->publish_state((float) cfg.dnd_end); break;
-        }
-      }
-    
+  // fast while something changes or needs attention, slow at night
+  uint32_t poll_interval_() {
+    const uint32_t fast = this->get_update_interval();
+    // queued, or sent and waiting for its ACK (CMD220 power/mode, CMD221 config, CMD222 filter reset)
+    const bool write_pending = has_pending_writes() || inflight_.contains(220) || inflight_.contains(221) ||
+                               inflight_.contains(222);
+    if (write_pending || last_warning_) return fast;
+    if (in_dnd_window_()) return std::max(fast, poll_dnd_ms_);
+    if (last_power_ != 0 && last_run_status_ != 0) return fast;  // pump running
+    return std::max(fast, poll_idle_ms_);
+  }
+
+  bool in_dnd_window_() const {
+    if (last_night_dnd_) return true;  // device says so
+    if (last_dnd_sw_ == 0) return false;
+    const time_t t = ::time(nullptr);
+    struct tm tm;
+    if (localtime_r(&t, &tm) == nullptr || tm.tm_year < 120) return false;  // clock not set
+    const int m = tm.tm_hour * 60 + tm.tm_min;
+    const int start = last_dnd_start_;
+    const int end = last_dnd_end_;
+    if (start == end) return false;
+    return start < end ? (m >= start && m < end) : (m >= start || m < end);  // over midnight
+  }
+
+  // charges the poll's round trip to the airtime budget
+  void poll_done_() {
+    if (poll_sent_ms_ == 0) return;
+    const float rtt = (float) (millis() - poll_sent_ms_);
+    poll_credit_ms_ -= rtt;
+    poll_rtt_ms_ += (rtt - poll_rtt_ms_) / 4.0f;
+    poll_sent_ms_ = 0;
+  }
+
+  // ----- Generic ACKs (format: FA FC FD <cmd> 02 <seq> 01 00 <status> FB) -----
+  void on_ack_(const PetkitFrame &f) {
+    auto ack = petkit_parse_ack_(f);
+    if (!ack.ok) return;
+
+    switch (ack.cmd) {
+      case 0x49:
+        ESP_LOGI(TAG, "CMD73 ACK: seq=%u status=%u", ack.seq, ack.value);
+        have_init_ = (ack.value == 1);
+        init_on_ack_(ack.cmd, ack.value);
+        break;
+      case 0x56:
+        ESP_LOGI(TAG, "CMD86 ACK: seq=%u status=%u", ack.seq, ack.value);
+        have_sync_ = (ack.value == 1);
+        init_on_ack_(ack.cmd, ack.value);
+        break;
+      case 0x54:
+        ESP_LOGI(TAG, "CMD84 ACK: seq=%u status=%u", ack.seq, ack.value);
+        have_time_ = (ack.value == 1);
+        init_on_ack_(ack.cmd, ack.value);
+        break;
+      case 0xDC:
+        ESP_LOGI(TAG, "CMD220 ACK: seq=%u status=%u", ack.seq, ack.value);
+        break;
+      case 0xDD:
+        ESP_LOGI(TAG, "CMD221 ACK: seq=%u status=%u", ack.seq, ack.value);
+        break;
+      case 0xDE:
+        ESP_LOGI(TAG, "CMD222 ACK: seq=%u status=%u", ack.seq, ack.value);
+        break;
+      default:
+        break;
+    }
+  }
+
+  // ----- response to CMD210 -----
+  void on_state_(const PetkitFrame &f) {
+    auto st = petkit_parse_state_d2_t_<PetkitModelProfile>(f);
+    if (!st.ok) return;
+    mark_state_seen_();
+
+    ESP_LOGI(TAG, "CMD210->D2: power=%u mode=%u dnd=%u warn(break=%u lack=%u filter=%u) filter=%u run=%u",
+             st.power, st.mode, st.night_dnd, st.breakdown_warn, st.lack_warn, st.filter_warn,
+             st.filter_percent, st.run_status);
+    last_power_ = st.power;
+    last_mode_ = st.mode;
+    last_filter_percent_raw_ = st.filter_percent;
+    track_poll_state_(st);
+    publish_filter_remaining_days_();
+
+    publish_field_(FIELD_POWER, st.power);
+    publish_field_(FIELD_MODE, st.mode);
+
+    publish_field_(FIELD_NIGHT_DND, st.night_dnd);
+    publish_field_(FIELD_LACK_WARN, st.lack_warn);
+    publish_field_(FIELD_BREAKDOWN_WARN, st.breakdown_warn);
+    publish_field_(FIELD_FILTER_WARN, st.filter_warn);
+
+    publish_field_(FIELD_FILTER_PERCENT, st.filter_percent);
+    publish_field_(FIELD_RUN_STATUS, st.run_status);
+    poll_done_();
+  }
+
+  // ----- response to CMD211 (get_config) -----
+  void on_config_(const PetkitFrame &f) {
+    auto cfg = petkit_parse_config_d3_(f);
+    if (!cfg.ok) return;
+
+    last_smart_on_min_  = cfg.smart_on;
+    last_smart_off_min_ = cfg.smart_off;
+    publish_filter_remaining_days_();
+
+    // 1) baseline config setzen (damit CMD221 möglich wird)
+    std::copy(f.data, f.data + PETKIT_CONFIG_LEN, last_config_payload_.begin());
+    have_config_payload_ = true;
+    cfg_fresh_ = true;
+
+    ESP_LOGD(TAG,
+      "CMD211->D3 cfg: smart_on=%u smart_off=%u light=%u bright=%u ls=%u le=%u dnd=%u ds=%u de=%u",
+      cfg.smart_on, cfg.smart_off, cfg.light_sw, cfg.brightness,
+      cfg.light_start, cfg.light_end, cfg.dnd_sw, cfg.dnd_start, cfg.dnd_end
+    );
+
+    // 2) Sensoren + Entities publishen (falls in YAML vorhanden)
+    publish_config_(cfg);
+    config_confirmed_();
+
+    // 3) flush a CMD221 batch that was waiting for this baseline
+    if (cfg_staged_mask_ != 0 && (cfg_baseline_requested_ || (int32_t) (millis() - cfg_flush_at_ms_) >= 0))
+      flush_config_();
+  }
+
+  void republish_config_() {
+    PetkitConfigD3 cfg;
+    petkit_decode_config_(last_config_payload_.data(), cfg);
+    publish_config_(cfg);
+  }
+
+  // ---------- publish cache ----------
+  // Every published value goes through publish_field_(), which skips values identical to
+  // the last published one and fans out to all entities bound to that field.
+  void publish_config_(const PetkitConfigD3 &cfg) {
+    last_dnd_sw_ = cfg.dnd_sw;
+    last_dnd_start_ = cfg.dnd_start;
+    last_dnd_end_ = cfg.dnd_end;
+    publish_field_(FIELD_SMART_ON, cfg.smart_on);
+    publish_field_(FIELD_SMART_OFF, cfg.smart_off);
+    publish_field_(FIELD_LIGHT_SW, cfg.light_sw);
+    publish_field_(FIELD_BRIGHTNESS, cfg.brightness);
+    publish_field_(FIELD_LIGHT_START, cfg.light_start);
+    publish_field_(FIELD_LIGHT_END, cfg.light_end);
+    publish_field_(FIELD_DND_SW, cfg.dnd_sw);
+    publish_field_(FIELD_DND_START, cfg.dnd_start);
+    publish_field_(FIELD_DND_END, cfg.dnd_end);
+  }
+
+  void publish_field_(PetkitField field, float v) {
+    if (!is_bound_(field)) return;
+    for (auto *b = field_run_(field); b != bindings_end_() && b->field == field; ++b) {
+      const bool same = (std::isnan(v) && std::isnan(b->last)) || v == b->last;
+      if (b->valid && same) continue;
+      b->last = v;
+      b->valid = true;
+      publish_binding_(*b, v);
+    }
+  }
+
+  // Drops the cached value so the next report is published even if unchanged, e.g. after
+  // an entity optimistically published a state the device may not confirm.
+  void invalidate_field_(PetkitField field) {
+    if (!is_bound_(field)) return;
+    for (auto *b = field_run_(field); b != bindings_end_() && b->field == field; ++b) b->valid = false;
+  }
+  void invalidate_all_fields_() {
+    for (auto *b = bindings_.data(); b != bindings_end_(); ++b) b->valid = false;
+  }
+
+  // Publishes every cached value again, changed or not.
+  void republish_all_() {
+    for (auto *b = bindings_.data(); b != bindings_end_(); ++b) {
+      if (b->valid) publish_binding_(*b, b->last);
+    }
+  }
+
+  bool is_bound_(PetkitField field) const { return (bound_mask_ >> field) & 1; }
+
+  template<typename S> void track_poll_state_(const S &st) {
+    last_run_status_ = st.run_status;
+    last_night_dnd_ = st.night_dnd != 0;
+    last_warning_ = st.lack_warn != 0 || st.breakdown_warn != 0 || st.filter_warn != 0;
+  }
+
+  // Kept sorted by field (YAML order within a field), so publish_field_ only walks the
+  // field's own run. Only called from codegen, before setup().
+  void add_binding_(PetkitBinding b, PetkitField field, PetkitBindKind kind) {
+    if (binding_count_ == bindings_.size()) {
+      ESP_LOGE(TAG, "more than %u entities bound, field %u dropped", (unsigned) bindings_.size(), (unsigned) field);
       return;
     }
+    b.field = field;
+    b.kind = kind;
+    auto *at = std::upper_bound(bindings_.data(), bindings_end_(), field,
+                                [](PetkitField f, const PetkitBinding &e) { return f < e.field; });
+    std::move_backward(at, bindings_end_(), bindings_end_() + 1);
+    *at = b;
+    binding_count_++;
+    bound_mask_ |= 1ull << field;
+  }
 
+  PetkitBinding *bindings_end_() { return bindings_.data() + binding_count_; }
+  PetkitBinding *field_run_(PetkitField field) {
+    return std::lower_bound(bindings_.data(), bindings_end_(), field,
+                            [](const PetkitBinding &b, PetkitField f) { return b.field < f; });
+  }
 
-  
-    // optional: log unknown cmds
-    ESP_LOGD(TAG, "Unhandled cmd=0x%02X len=%u", cmd, (unsigned) len);
+  static void publish_binding_(const PetkitBinding &b, float v) {
+    switch (b.kind) {
+      case BIND_SENSOR:
+        b.sensor->publish_state(v);
+        break;
+      case BIND_BINARY_SENSOR:
+        b.binary_sensor->publish_state(v != 0);
+        break;
+      case BIND_SWITCH:
+        b.sw->publish_state(v != 0);
+        break;
+      case BIND_NUMBER:
+        b.number->publish_state(v);
+        break;
+      case BIND_MODE_SELECT:
+        b.select->publish_state((v == 2) ? "smart" : "normal");
+        break;
+    }
   }
 };
 
+// All per-fountain state lives inline (queues, caches, metrics, identity, config), so the
+// footprint is fixed once setup() has sized the entity lists and the capture ring.
+static_assert(sizeof(PetkitFountain) <= 4096, "PetkitFountain grew past its RAM budget");
+
+// ------------- RX dispatch table -------------
+constexpr std::array<PetkitCmdEntry, 256> PetkitFountain::make_dispatch_table_() {
+  std::array<PetkitCmdEntry, 256> t{};
+  t[0xD5] = {&PetkitFountain::on_identifiers_, "CMD213", PETKIT_ANY_TYPE, PETKIT_D5_MIN_LEN, 0xFF,
+             &PetkitFountain::on_identifiers_done_};
+  t[0xE6] = {&PetkitFountain::on_state_push_, "CMD0xE6", PETKIT_ANY_TYPE, PETKIT_E6_MIN_LEN, 0xFF};
+  t[0xD2] = {&PetkitFountain::on_state_, "CMD0xD2", PETKIT_TYPE_RESPONSE, PETKIT_D2_MIN_LEN, 0xFF};
+  t[0xD3] = {&PetkitFountain::on_config_, "CMD0xD3", PETKIT_TYPE_RESPONSE, PETKIT_CONFIG_LEN, PETKIT_CONFIG_LEN,
+             &PetkitFountain::on_config_read_done_};
+  t[0x49] = {&PetkitFountain::on_ack_, "CMD73 ACK", PETKIT_TYPE_RESPONSE, 1, 0xFF};
+  t[0x56] = {&PetkitFountain::on_ack_, "CMD86 ACK", PETKIT_TYPE_RESPONSE, 1, 0xFF};
+  t[0x54] = {&PetkitFountain::on_ack_, "CMD84 ACK", PETKIT_TYPE_RESPONSE, 1, 0xFF};
+  t[0xDC] = {&PetkitFountain::on_ack_, "CMD220 ACK", PETKIT_TYPE_RESPONSE, 1, 0xFF,
+             &PetkitFountain::on_mode_write_done_};
+  t[0xDD] = {&PetkitFountain::on_ack_, "CMD221 ACK", PETKIT_TYPE_RESPONSE, 1, 0xFF,
+             &PetkitFountain::on_config_write_done_};
+  t[0xDE] = {&PetkitFountain::on_ack_, "CMD222 ACK", PETKIT_TYPE_RESPONSE, 1, 0xFF,
+             &PetkitFountain::on_filter_reset_done_};
+  return t;
+}
+
+inline const PetkitCmdEntry &PetkitFountain::dispatch_entry_(uint8_t cmd) {
+  static constexpr std::array<PetkitCmdEntry, 256> TABLE = make_dispatch_table_();
+  return TABLE[cmd];
+}
+
 // ------------- entity implementations -------------
 inline void PetkitLightSwitch::write_state(bool state) {
   if (!this->parent_) return;
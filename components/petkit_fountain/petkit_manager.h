@@ -0,0 +1,129 @@
+#pragma once
+
+#include "esphome.h"
+#include "petkit_fountain.h"
+
+#include <vector>
+
+namespace esphome {
+namespace petkit_fountain {
+
+// Shares a bounded number of BLE connections between fountains. A turn enables the
+// fountain's ble_client, lets the session run (init chain, refresh, queued writes) and
+// disables the client again once the session is done or times out.
+//
+// Rotation: a fountain with queued writes goes first, then the one furthest past its
+// freshness target (age / max_age); ties go to the one served longest ago. Every turn
+// counts as served, so an unreachable fountain cannot starve the others.
+class PetkitFountainManager : public Component {
+ public:
+  void set_max_connections(uint8_t n) { max_connections_ = n; }
+  void set_session_timeout(uint32_t ms) { session_timeout_ms_ = ms; }
+  void add_fountain(PetkitFountain *f, uint32_t max_age_ms) {
+    f->set_managed(true);
+    entries_.push_back(Entry{f, max_age_ms});
+  }
+
+  float get_setup_priority() const override { return setup_priority::AFTER_BLUETOOTH; }
+
+  void setup() override {
+    for (auto &e : entries_) {
+      auto *client = e.fountain->parent();
+      if (client) client->set_enabled(false);
+    }
+  }
+
+  void loop() override {
+    const uint32_t now = millis();
+    if ((now - last_run_ms_) < RUN_INTERVAL_MS) return;
+    last_run_ms_ = now;
+
+    for (auto &e : entries_) {
+      if (!e.active) continue;
+      if (e.fountain->is_session_done(e.session_start_ms)) {
+        release_(e, now, "done", false);
+      } else if ((now - e.session_start_ms) >= session_timeout_ms_) {
+        release_(e, now, "timeout", true);
+      }
+    }
+
+    while (active_ < max_connections_) {
+      Entry *next = pick_(now);
+      if (next == nullptr) break;
+      start_(*next, now);
+    }
+  }
+
+  void dump_config() override {
+    ESP_LOGCONFIG(TAG, "Petkit fountain manager: %u fountain(s), %u connection(s), session timeout %ums",
+                  (unsigned) entries_.size(), (unsigned) max_connections_, (unsigned) session_timeout_ms_);
+  }
+
+ protected:
+  static constexpr const char *TAG = "petkit_manager";
+  static constexpr uint32_t RUN_INTERVAL_MS = 250;
+
+  struct Entry {
+    PetkitFountain *fountain;
+    uint32_t max_age_ms;
+    bool active{false};
+    bool served{false};
+    uint32_t session_start_ms{0};
+    uint32_t last_served_ms{0};
+    uint32_t backoff_until_ms{0};  // after a timeout, pending writes don't jump the rotation
+  };
+
+  Entry *pick_(uint32_t now) {
+    Entry *best = nullptr;
+    float best_score = 0.0f;
+    uint32_t best_age = 0;
+    for (auto &e : entries_) {
+      if (e.active || e.fountain->parent() == nullptr) continue;
+      const uint32_t age = now - e.last_served_ms;
+      float score;
+      if (e.fountain->has_pending_writes() && (int32_t) (now - e.backoff_until_ms) >= 0) {
+        score = 1e9f;
+      } else if (!e.served) {
+        score = 1e8f;
+      } else {
+        score = e.max_age_ms == 0 ? 1.0f : float(age) / float(e.max_age_ms);
+        if (score < 1.0f) continue;  // still fresh
+      }
+      if (best == nullptr || score > best_score || (score == best_score && age > best_age)) {
+        best = &e;
+        best_score = score;
+        best_age = age;
+      }
+    }
+    return best;
+  }
+
+  void start_(Entry &e, uint32_t now) {
+    e.active = true;
+    e.session_start_ms = now;
+    active_++;
+    ESP_LOGD(TAG, "Session start: fountain #%u", index_(e));
+    e.fountain->parent()->set_enabled(true);
+  }
+
+  void release_(Entry &e, uint32_t now, const char *why, bool timed_out) {
+    e.active = false;
+    e.backoff_until_ms = timed_out ? now + e.max_age_ms : now;
+    e.served = true;
+    e.last_served_ms = now;
+    active_--;
+    ESP_LOGD(TAG, "Session %s after %ums: fountain #%u", why, (unsigned) (now - e.session_start_ms), index_(e));
+    e.fountain->parent()->set_enabled(false);
+  }
+
+  unsigned index_(const Entry &e) const { return (unsigned) (&e - entries_.data()); }
+
+  std::vector<Entry> entries_;
+  uint8_t max_connections_{1};
+  uint8_t active_{0};
+  uint32_t session_timeout_ms_{30000};
+  uint32_t last_run_ms_{0};
+};
+
+}  // namespace petkit_fountain
+}  // namespace esphome
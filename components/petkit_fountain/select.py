@@ -23,5 +23,4 @@ async def to_code(config):
     if CONF_MODE_SELECT in config:
         # Options are defined here (works across versions)
         sel = await select.new_select(config[CONF_MODE_SELECT], options=["normal", "smart"])
-        cg.add(sel.set_parent(parent))
-        cg.add(parent.set_mode_select(sel))
+        cg.add(parent.bind_mode_select(sel))
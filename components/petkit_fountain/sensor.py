@@ -1,12 +1,32 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
+import esphome.final_validate as fv
 from esphome.components import ble_client, sensor
-from esphome.const import CONF_ID
+from esphome.core import CORE
+from esphome.const import (
+    CONF_ID,
+    CONF_PLATFORM,
+    DEVICE_CLASS_DURATION,
+    DEVICE_CLASS_ENERGY,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_BYTES,
+    UNIT_KILOWATT_HOURS,
+    UNIT_MILLISECOND,
+    UNIT_PERCENT,
+    UNIT_SECOND,
+)
+
+from . import CONF_PARENT_ID
+from . import binary_sensor as pf_binary_sensor, number as pf_number, switch as pf_switch
+from .select import CONF_MODE_SELECT
 
 CONF_BLE_CLIENT_ID = "ble_client_id"
 CONF_SERVICE_UUID = "service_uuid"
 CONF_NOTIFY_UUID = "notify_uuid"
 CONF_WRITE_UUID = "write_uuid"
+CONF_MODEL = "model"
 
 # Sensor keys
 CONF_POWER = "power"
@@ -28,15 +48,201 @@ CONF_DND_SWITCH = "dnd_switch"
 CONF_DND_START_MIN = "dnd_start_min"
 CONF_DND_END_MIN = "dnd_end_min"
 CONF_FILTER_REMAINING_DAYS = "filter_remaining_days"
+# band around the learned estimate (published once it is available)
+CONF_FILTER_REMAINING_DAYS_LOW = "filter_remaining_days_low"
+CONF_FILTER_REMAINING_DAYS_HIGH = "filter_remaining_days_high"
+
+# Accumulated usage (lifetime / local day), built from the E6 "today" counters
+CONF_TOTAL_PUMP_RUNTIME = "total_pump_runtime"
+CONF_TOTAL_PURIFIED_WATER_TIMES = "total_purified_water_times"
+CONF_TOTAL_ENERGY = "total_energy"
+CONF_DAILY_PUMP_RUNTIME = "daily_pump_runtime"
+CONF_DAILY_PURIFIED_WATER_TIMES = "daily_purified_water_times"
+CONF_DAILY_ENERGY = "daily_energy"
+CONF_ENERGY_SCALE = "energy_scale"
+
+# Duty cycle: connect on a schedule instead of staying connected
+CONF_DUTY_CYCLE_INTERVAL = "duty_cycle_interval"
+CONF_DUTY_CYCLE_SESSION_TIMEOUT = "duty_cycle_session_timeout"
+CONF_CONNECTED_FRACTION = "connected_fraction"
+
+# TX queue diagnostics
+CONF_TX_QUEUE_DEPTH = "tx_queue_depth"
+CONF_TX_DROPPED = "tx_dropped"
+
+# Link metrics (diagnostic)
+CONF_TX_FRAMES = "tx_frames"
+CONF_RX_FRAMES = "rx_frames"
+CONF_RETRIES = "retries"
+CONF_REPLY_TIMEOUTS = "reply_timeouts"
+CONF_PARSE_ERRORS = "parse_errors"
+CONF_UNHANDLED_FRAMES = "unhandled_frames"
+CONF_TX_QUEUE_HIGH_WATER = "tx_queue_high_water"
+CONF_FIRST_STATE_LATENCY = "first_state_latency"
+CONF_REPLY_LATENCY = "reply_latency"
+
+# Heap probe around the RX/TX handlers (diagnostic, only active when configured)
+CONF_HEAP_FREE = "heap_free"
+CONF_HEAP_LARGEST_BLOCK = "heap_largest_block"
+CONF_RX_HEAP_ALLOCS = "rx_heap_allocs"
+CONF_RX_HEAP_BYTES = "rx_heap_bytes"
+CONF_TX_HEAP_ALLOCS = "tx_heap_allocs"
+CONF_TX_HEAP_BYTES = "tx_heap_bytes"
+
+
+# Publish cache
+CONF_FULL_REPUBLISH_INTERVAL = "full_republish_interval"
+CONF_REPUBLISH_ON_RECONNECT = "republish_on_reconnect"
+
+# Packet capture ring (number of frames kept, 0 = off)
+CONF_PACKET_CAPTURE = "packet_capture"
+
+# Burst mode: write without response, delivery confirmed by the device's ACK frames
+CONF_WRITE_WITHOUT_RESPONSE = "write_without_response"
+
+# Partial config changes within this window are merged into one CMD221
+CONF_CONFIG_COALESCE_WINDOW = "config_coalesce_window"
+
+# Adaptive polling (update_interval is the fast rate)
+CONF_POLL_IDLE_INTERVAL = "poll_idle_interval"
+CONF_POLL_DND_INTERVAL = "poll_dnd_interval"
+CONF_POLL_AIRTIME_BUDGET = "poll_airtime_budget"
 
 petkit_ns = cg.esphome_ns.namespace("petkit_fountain")
 PetkitFountain = petkit_ns.class_("PetkitFountain", cg.PollingComponent, ble_client.BLEClientNode)
+PetkitField = petkit_ns.enum("PetkitField")
+
+# Plain sensors: config key -> field they are bound to
+_FIELDS = {
+    CONF_POWER: PetkitField.FIELD_POWER,
+    CONF_MODE: PetkitField.FIELD_MODE,
+    CONF_IS_NIGHT_DND: PetkitField.FIELD_NIGHT_DND,
+    CONF_FILTER_PERCENT: PetkitField.FIELD_FILTER_PERCENT,
+    CONF_RUN_STATUS: PetkitField.FIELD_RUN_STATUS,
+    CONF_WATER_PUMP_RUNTIME_SECONDS: PetkitField.FIELD_PUMP_RUNTIME,
+    CONF_TODAY_PUMP_RUNTIME_SECONDS: PetkitField.FIELD_TODAY_PUMP_RUNTIME,
+    CONF_TODAY_PURIFIED_WATER_TIMES: PetkitField.FIELD_TODAY_PURIFIED,
+    CONF_TODAY_ENERGY_KWH: PetkitField.FIELD_TODAY_ENERGY,
+    CONF_SMART_WORKING_TIME: PetkitField.FIELD_SMART_ON,
+    CONF_SMART_SLEEP_TIME: PetkitField.FIELD_SMART_OFF,
+    CONF_LIGHT_SWITCH: PetkitField.FIELD_LIGHT_SW,
+    CONF_LIGHT_BRIGHTNESS: PetkitField.FIELD_BRIGHTNESS,
+    CONF_LIGHT_SCHEDULE_START_MIN: PetkitField.FIELD_LIGHT_START,
+    CONF_LIGHT_SCHEDULE_END_MIN: PetkitField.FIELD_LIGHT_END,
+    CONF_DND_SWITCH: PetkitField.FIELD_DND_SW,
+    CONF_DND_START_MIN: PetkitField.FIELD_DND_START,
+    CONF_DND_END_MIN: PetkitField.FIELD_DND_END,
+    CONF_FILTER_REMAINING_DAYS: PetkitField.FIELD_FILTER_REMAINING_DAYS,
+    CONF_FILTER_REMAINING_DAYS_LOW: PetkitField.FIELD_FILTER_DAYS_LOW,
+    CONF_FILTER_REMAINING_DAYS_HIGH: PetkitField.FIELD_FILTER_DAYS_HIGH,
+    CONF_CONNECTED_FRACTION: PetkitField.FIELD_CONNECTED_FRACTION,
+    CONF_TX_QUEUE_DEPTH: PetkitField.FIELD_TX_QUEUE_DEPTH,
+    CONF_TX_DROPPED: PetkitField.FIELD_TX_DROPPED,
+    CONF_TX_QUEUE_HIGH_WATER: PetkitField.FIELD_TX_QUEUE_HIGH_WATER,
+}
+_COUNTERS = {
+    CONF_TX_FRAMES: PetkitField.FIELD_TX_FRAMES,
+    CONF_RX_FRAMES: PetkitField.FIELD_RX_FRAMES,
+    CONF_RETRIES: PetkitField.FIELD_RETRIES,
+    CONF_REPLY_TIMEOUTS: PetkitField.FIELD_REPLY_TIMEOUTS,
+    CONF_PARSE_ERRORS: PetkitField.FIELD_PARSE_ERRORS,
+    CONF_UNHANDLED_FRAMES: PetkitField.FIELD_UNHANDLED_FRAMES,
+    # allocations made inside the handlers (petkit_alloc_probe.cpp)
+    CONF_RX_HEAP_ALLOCS: PetkitField.FIELD_RX_HEAP_ALLOCS,
+    CONF_TX_HEAP_ALLOCS: PetkitField.FIELD_TX_HEAP_ALLOCS,
+}
+_HEAP_BYTES = {
+    # lowest values seen around the handlers during the last update interval
+    CONF_HEAP_FREE: (STATE_CLASS_MEASUREMENT, PetkitField.FIELD_HEAP_FREE),
+    CONF_HEAP_LARGEST_BLOCK: (STATE_CLASS_MEASUREMENT, PetkitField.FIELD_HEAP_LARGEST_BLOCK),
+    # bytes those allocations requested
+    CONF_RX_HEAP_BYTES: (STATE_CLASS_TOTAL_INCREASING, PetkitField.FIELD_RX_HEAP_BYTES),
+    CONF_TX_HEAP_BYTES: (STATE_CLASS_TOTAL_INCREASING, PetkitField.FIELD_TX_HEAP_BYTES),
+}
+# sensors that need the allocator hook
+_ALLOC_PROBE_KEYS = (CONF_RX_HEAP_ALLOCS, CONF_RX_HEAP_BYTES, CONF_TX_HEAP_ALLOCS, CONF_TX_HEAP_BYTES)
+_LATENCIES = {
+    CONF_FIRST_STATE_LATENCY: PetkitField.FIELD_FIRST_STATE_LATENCY,
+    # 90th percentile of all request/reply round trips
+    CONF_REPLY_LATENCY: PetkitField.FIELD_REPLY_LATENCY,
+}
+
+# Frame layout per fountain family; a pinned model becomes the PETKIT_MODEL_PROFILE define,
+# so one build holds one layout (w5 / w4x: no capture yet, unverified)
+MODEL_PROFILES = {
+    "auto": petkit_ns.struct("PetkitProfileAuto"),
+    "w5": petkit_ns.struct("PetkitProfileW5"),
+    "w4x": petkit_ns.struct("PetkitProfileW5"),
+    "ctw2": petkit_ns.struct("PetkitProfileCTW2"),
+    "ctw3": petkit_ns.struct("PetkitProfileCTW3"),
+}
 
 
 def _opt_sensor():
     return sensor.sensor_schema()
 
 
+def _runtime_total_sensor():
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_SECOND,
+        accuracy_decimals=0,
+        device_class=DEVICE_CLASS_DURATION,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+    )
+
+
+def _times_total_sensor():
+    return sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+    )
+
+
+def _energy_total_sensor():
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_KILOWATT_HOURS,
+        accuracy_decimals=3,
+        device_class=DEVICE_CLASS_ENERGY,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+    )
+
+
+_USAGE = {
+    CONF_TOTAL_PUMP_RUNTIME: (_runtime_total_sensor, PetkitField.FIELD_TOTAL_PUMP_RUNTIME),
+    CONF_TOTAL_PURIFIED_WATER_TIMES: (_times_total_sensor, PetkitField.FIELD_TOTAL_PURIFIED),
+    CONF_TOTAL_ENERGY: (_energy_total_sensor, PetkitField.FIELD_TOTAL_ENERGY),
+    CONF_DAILY_PUMP_RUNTIME: (_runtime_total_sensor, PetkitField.FIELD_DAILY_PUMP_RUNTIME),
+    CONF_DAILY_PURIFIED_WATER_TIMES: (_times_total_sensor, PetkitField.FIELD_DAILY_PURIFIED),
+    CONF_DAILY_ENERGY: (_energy_total_sensor, PetkitField.FIELD_DAILY_ENERGY),
+}
+
+
+def _counter_sensor():
+    return sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+
+def _bytes_sensor(state_class):
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_BYTES,
+        accuracy_decimals=0,
+        state_class=state_class,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+
+def _latency_sensor():
+    return sensor.sensor_schema(
+        unit_of_measurement=UNIT_MILLISECOND,
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    )
+
+
 CONFIG_SCHEMA = cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(PetkitFountain),
@@ -44,7 +250,23 @@ CONFIG_SCHEMA = cv.Schema(
         cv.Required(CONF_SERVICE_UUID): cv.string,
         cv.Required(CONF_NOTIFY_UUID): cv.string,
         cv.Required(CONF_WRITE_UUID): cv.string,
+        cv.Optional(CONF_MODEL, default="auto"): cv.one_of(*MODEL_PROFILES, lower=True),
 
+        # Only changed values are published; optionally republish everything periodically
+        cv.Optional(CONF_FULL_REPUBLISH_INTERVAL): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_REPUBLISH_ON_RECONNECT, default=True): cv.boolean,
+        # records of ~56 B; PETKIT_CAPTURE_DEFAULT / PETKIT_CAPTURE_MAX in petkit_codec.h
+        cv.Optional(CONF_PACKET_CAPTURE, default=16): cv.int_range(min=0, max=128),
+        cv.Optional(CONF_WRITE_WITHOUT_RESPONSE, default=False): cv.boolean,
+        cv.Optional(CONF_DUTY_CYCLE_INTERVAL): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_DUTY_CYCLE_SESSION_TIMEOUT, default="30s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_CONFIG_COALESCE_WINDOW, default="200ms"): cv.All(
+            cv.positive_time_period_milliseconds, cv.Range(max=cv.TimePeriod(milliseconds=1000))
+        ),
+
+        cv.Optional(CONF_POLL_IDLE_INTERVAL, default="5min"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_DND_INTERVAL, default="30min"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_POLL_AIRTIME_BUDGET, default="1%"): cv.percentage,
         cv.Optional(CONF_POWER): _opt_sensor(),
         cv.Optional(CONF_MODE): _opt_sensor(),
         cv.Optional(CONF_IS_NIGHT_DND): _opt_sensor(),
@@ -64,10 +286,88 @@ CONFIG_SCHEMA = cv.Schema(
         cv.Optional(CONF_DND_START_MIN): _opt_sensor(),
         cv.Optional(CONF_DND_END_MIN): _opt_sensor(),
         cv.Optional(CONF_FILTER_REMAINING_DAYS): _opt_sensor(),
+        cv.Optional(CONF_FILTER_REMAINING_DAYS_LOW): _opt_sensor(),
+        cv.Optional(CONF_FILTER_REMAINING_DAYS_HIGH): _opt_sensor(),
+        **{cv.Optional(key): schema() for key, (schema, _) in _USAGE.items()},
+        # kWh per raw E6 energy count
+        cv.Optional(CONF_ENERGY_SCALE, default=0.001): cv.positive_float,
+        cv.Optional(CONF_CONNECTED_FRACTION): sensor.sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_TX_QUEUE_DEPTH): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_TX_DROPPED): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_TX_QUEUE_HIGH_WATER): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        **{cv.Optional(key): _counter_sensor() for key in _COUNTERS},
+        **{cv.Optional(key): _latency_sensor() for key in _LATENCIES},
+        **{cv.Optional(key): _bytes_sensor(state_class) for key, (state_class, _) in _HEAP_BYTES.items()},
     }
 ).extend(cv.polling_component_schema("60s"))
 
 
+def _final_validate(config):
+    # the profile is a build-wide define: every fountain must name the same layout
+    models = {
+        str(MODEL_PROFILES[conf[CONF_MODEL]])
+        for conf in fv.full_config.get().get("sensor", [])
+        if conf.get("platform") == "petkit_fountain"
+    }
+    if len(models) > 1:
+        raise cv.Invalid(
+            "all petkit_fountain sensors in one build share the model profile; "
+            "use model: auto when mixing models",
+            path=[CONF_MODEL],
+        )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = _final_validate
+
+
+def _bound_fields():
+    return {
+        **_FIELDS,
+        **{k: f for k, (_, f) in _USAGE.items()},
+        **_COUNTERS,
+        **_LATENCIES,
+        **{k: f for k, (_, f) in _HEAP_BYTES.items()},
+    }
+
+
+def _max_bindings(full_config):
+    # Size of the binding registry: the most entities any fountain binds, over every
+    # petkit_fountain platform (sensors bind on the fountain itself, the rest via parent_id)
+    platforms = {
+        "sensor": (CONF_ID, _bound_fields()),
+        "binary_sensor": (CONF_PARENT_ID, pf_binary_sensor._FIELDS),
+        "switch": (CONF_PARENT_ID, pf_switch._FIELDS),
+        "number": (CONF_PARENT_ID, pf_number._FIELDS),
+        "select": (CONF_PARENT_ID, {CONF_MODE_SELECT: None}),
+    }
+    counts = {}
+    for domain, (id_key, fields) in platforms.items():
+        for conf in full_config.get(domain, []):
+            if conf.get(CONF_PLATFORM) != "petkit_fountain":
+                continue
+            fountain = conf[id_key].id
+            counts[fountain] = counts.get(fountain, 0) + sum(1 for k in fields if k in conf)
+    return max([1, *counts.values()])
+
+
 async def to_code(config):
     var = cg.new_Pvariable(
         config[CONF_ID],
@@ -77,80 +377,32 @@ async def to_code(config):
     )
     await cg.register_component(var, config)
     await ble_client.register_ble_node(var, config)
+    if config[CONF_MODEL] != "auto":
+        cg.add_define("PETKIT_MODEL_PROFILE", str(MODEL_PROFILES[config[CONF_MODEL]]))
 
-    if CONF_POWER in config:
-        s = await sensor.new_sensor(config[CONF_POWER])
-        cg.add(var.set_power_sensor(s))
-
-    if CONF_MODE in config:
-        s = await sensor.new_sensor(config[CONF_MODE])
-        cg.add(var.set_mode_sensor(s))
-
-    if CONF_IS_NIGHT_DND in config:
-        s = await sensor.new_sensor(config[CONF_IS_NIGHT_DND])
-        cg.add(var.set_is_night_dnd_sensor(s))
-
-    if CONF_FILTER_PERCENT in config:
-        s = await sensor.new_sensor(config[CONF_FILTER_PERCENT])
-        cg.add(var.set_filter_percent_sensor(s))
-
-    if CONF_RUN_STATUS in config:
-        s = await sensor.new_sensor(config[CONF_RUN_STATUS])
-        cg.add(var.set_run_status_sensor(s))
-
-    if CONF_WATER_PUMP_RUNTIME_SECONDS in config:
-        s = await sensor.new_sensor(config[CONF_WATER_PUMP_RUNTIME_SECONDS])
-        cg.add(var.set_water_pump_runtime_seconds_sensor(s))
-
-    if CONF_TODAY_PUMP_RUNTIME_SECONDS in config:
-        s = await sensor.new_sensor(config[CONF_TODAY_PUMP_RUNTIME_SECONDS])
-        cg.add(var.set_today_pump_runtime_seconds_sensor(s))
-
-    if CONF_TODAY_PURIFIED_WATER_TIMES in config:
-        s = await sensor.new_sensor(config[CONF_TODAY_PURIFIED_WATER_TIMES])
-        cg.add(var.set_today_purified_water_times_sensor(s))
-
-    if CONF_TODAY_ENERGY_KWH in config:
-        s = await sensor.new_sensor(config[CONF_TODAY_ENERGY_KWH])
-        cg.add(var.set_today_energy_kwh_sensor(s))
-
-    if CONF_SMART_WORKING_TIME in config:
-        s = await sensor.new_sensor(config[CONF_SMART_WORKING_TIME])
-        cg.add(var.set_smart_working_time_sensor(s))
-
-    if CONF_SMART_SLEEP_TIME in config:
-        s = await sensor.new_sensor(config[CONF_SMART_SLEEP_TIME])
-        cg.add(var.set_smart_sleep_time_sensor(s))
-
-    if CONF_LIGHT_SWITCH in config:
-        s = await sensor.new_sensor(config[CONF_LIGHT_SWITCH])
-        cg.add(var.set_light_switch_sensor(s))
-
-    if CONF_LIGHT_BRIGHTNESS in config:
-        s = await sensor.new_sensor(config[CONF_LIGHT_BRIGHTNESS])
-        cg.add(var.set_light_brightness_sensor(s))
-
-    if CONF_LIGHT_SCHEDULE_START_MIN in config:
-        s = await sensor.new_sensor(config[CONF_LIGHT_SCHEDULE_START_MIN])
-        cg.add(var.set_light_schedule_start_min_sensor(s))
-
-    if CONF_LIGHT_SCHEDULE_END_MIN in config:
-        s = await sensor.new_sensor(config[CONF_LIGHT_SCHEDULE_END_MIN])
-        cg.add(var.set_light_schedule_end_min_sensor(s))
-
-    if CONF_DND_SWITCH in config:
-        s = await sensor.new_sensor(config[CONF_DND_SWITCH])
-        cg.add(var.set_dnd_switch_sensor(s))
-
-    if CONF_DND_START_MIN in config:
-        s = await sensor.new_sensor(config[CONF_DND_START_MIN])
-        cg.add(var.set_dnd_start_min_sensor(s))
-
-    if CONF_DND_END_MIN in config:
-        s = await sensor.new_sensor(config[CONF_DND_END_MIN])
-        cg.add(var.set_dnd_end_min_sensor(s))
-
-    if CONF_FILTER_REMAINING_DAYS in config:
-        s = await sensor.new_sensor(config[CONF_FILTER_REMAINING_DAYS])
-        cg.add(var.set_filter_remaining_days_sensor(s))
+    if CONF_FULL_REPUBLISH_INTERVAL in config:
+        cg.add(var.set_full_republish_interval(config[CONF_FULL_REPUBLISH_INTERVAL]))
+    cg.add(var.set_republish_on_reconnect(config[CONF_REPUBLISH_ON_RECONNECT]))
+    cg.add(var.set_packet_capture_size(config[CONF_PACKET_CAPTURE]))
+    if config[CONF_WRITE_WITHOUT_RESPONSE]:
+        cg.add(var.set_write_without_response(True))
+    cg.add(var.set_config_coalesce_window(config[CONF_CONFIG_COALESCE_WINDOW]))
+    cg.add(var.set_energy_scale(config[CONF_ENERGY_SCALE]))
+    cg.add(var.set_poll_idle_interval(config[CONF_POLL_IDLE_INTERVAL]))
+    cg.add(var.set_poll_dnd_interval(config[CONF_POLL_DND_INTERVAL]))
+    cg.add(var.set_poll_airtime_budget(config[CONF_POLL_AIRTIME_BUDGET]))
+    if CONF_DUTY_CYCLE_INTERVAL in config:
+        cg.add(var.set_duty_cycle_interval(config[CONF_DUTY_CYCLE_INTERVAL]))
+        cg.add(var.set_duty_cycle_session_timeout(config[CONF_DUTY_CYCLE_SESSION_TIMEOUT]))
 
+    # only configured sensors get a binding
+    cg.add_define("PETKIT_MAX_BINDINGS", _max_bindings(CORE.config))
+    if any(key in config for key in _ALLOC_PROBE_KEYS):
+        # route the allocator through the counting wrappers in petkit_alloc_probe.cpp
+        cg.add_define("USE_PETKIT_ALLOC_PROBE")
+        for fn in ("malloc", "calloc", "realloc"):
+            cg.add_build_flag(f"-Wl,--wrap={fn}")
+    for key, field in _bound_fields().items():
+        if key in config:
+            s = await sensor.new_sensor(config[key])
+            cg.add(var.bind_sensor(field, s))
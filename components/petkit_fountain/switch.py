@@ -14,6 +14,13 @@ PetkitFountain = petkit_ns.class_("PetkitFountain")
 PetkitLightSwitch = petkit_ns.class_("PetkitLightSwitch", switch.Switch)
 PetkitDndSwitch = petkit_ns.class_("PetkitDndSwitch", switch.Switch)
 PetkitPowerSwitch = petkit_ns.class_("PetkitPowerSwitch", switch.Switch)
+PetkitField = petkit_ns.enum("PetkitField")
+
+_FIELDS = {
+    CONF_LIGHT_SWITCH: PetkitField.FIELD_LIGHT_SW,
+    CONF_DND_SWITCH: PetkitField.FIELD_DND_SW,
+    CONF_POWER_SWITCH: PetkitField.FIELD_POWER,
+}
 
 CONFIG_SCHEMA = cv.Schema(
     {
@@ -28,17 +35,7 @@ CONFIG_SCHEMA = cv.Schema(
 async def to_code(config):
     parent = await cg.get_variable(config[CONF_PARENT_ID])
 
-    if CONF_LIGHT_SWITCH in config:
-        sw = await switch.new_switch(config[CONF_LIGHT_SWITCH])
-        cg.add(sw.set_parent(parent))
-        cg.add(parent.set_light_switch(sw))
-
-    if CONF_DND_SWITCH in config:
-        sw = await switch.new_switch(config[CONF_DND_SWITCH])
-        cg.add(sw.set_parent(parent))
-        cg.add(parent.set_dnd_switch(sw))
-
-    if CONF_POWER_SWITCH in config:
-        sw = await switch.new_switch(config[CONF_POWER_SWITCH])
-        cg.add(sw.set_parent(parent))
-        cg.add(parent.set_power_switch(sw))
+    for key, field in _FIELDS.items():
+        if key in config:
+            sw = await switch.new_switch(config[key])
+            cg.add(parent.bind_switch(field, sw))
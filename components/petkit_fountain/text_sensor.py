@@ -1,15 +1,26 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.components import text_sensor
+from esphome.const import ENTITY_CATEGORY_DIAGNOSTIC
 
 from . import PetkitFountain, CONF_PARENT_ID
 
 CONF_SERIAL = "serial"
+CONF_LINK_SUMMARY = "link_summary"
+CONF_FILTER_REPLACEMENT_DATE = "filter_replacement_date"
+CONF_MODEL_PROFILE = "model_profile"
 
 CONFIG_SCHEMA = cv.Schema(
     {
         cv.Required(CONF_PARENT_ID): cv.use_id(PetkitFountain),
         cv.Optional(CONF_SERIAL): text_sensor.text_sensor_schema(),
+        cv.Optional(CONF_FILTER_REPLACEMENT_DATE): text_sensor.text_sensor_schema(),
+        cv.Optional(CONF_MODEL_PROFILE): text_sensor.text_sensor_schema(
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_LINK_SUMMARY): text_sensor.text_sensor_schema(
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
     }
 )
 
@@ -19,3 +30,15 @@ async def to_code(config):
     if CONF_SERIAL in config:
         ts = await text_sensor.new_text_sensor(config[CONF_SERIAL])
         cg.add(parent.set_serial_text_sensor(ts))
+
+    if CONF_FILTER_REPLACEMENT_DATE in config:
+        ts = await text_sensor.new_text_sensor(config[CONF_FILTER_REPLACEMENT_DATE])
+        cg.add(parent.set_filter_replacement_date_text_sensor(ts))
+
+    if CONF_MODEL_PROFILE in config:
+        ts = await text_sensor.new_text_sensor(config[CONF_MODEL_PROFILE])
+        cg.add(parent.set_model_profile_text_sensor(ts))
+
+    if CONF_LINK_SUMMARY in config:
+        ts = await text_sensor.new_text_sensor(config[CONF_LINK_SUMMARY])
+        cg.add(parent.set_link_summary_text_sensor(ts))
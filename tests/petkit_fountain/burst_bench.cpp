@@ -0,0 +1,67 @@
+// Write-with-response vs write_without_response against the simulated fountain (30 ms reply
+// latency, 16 ms loop). Prints the mean latency of back-to-back CMD210+211 refreshes and the
+// resulting read throughput for a range of GATT write-completion delays; the README figures
+// come from this output.
+#include <cstdio>
+
+#include "sim_rig.h"
+#include "test_util.h"
+
+using esphome::petkit_fountain::PetkitActionButton;
+using test::SimRig;
+
+struct Result {
+  uint32_t refresh_ms{0};
+  float reads_per_s{0};
+};
+
+static constexpr int REFRESHES = 20;  // 40 reads
+
+// Asks for CMD210+211 and waits until both are answered; returns the elapsed ms, 0 on timeout.
+static uint32_t refresh(SimRig &rig) {
+  const uint32_t t0 = host::now_ms;
+  rig.pf.do_action(PetkitActionButton::REFRESH);
+  rig.pf.do_action(PetkitActionButton::READ_CONFIG);
+  for (uint32_t i = 0; i < 5000; i++) {
+    rig.run(1);
+    if (rig.pf.is_session_done(t0)) return host::now_ms - t0;
+  }
+  return 0;
+}
+
+static Result measure(bool no_rsp, uint32_t write_event_ms) {
+  SimRig rig;
+  rig.write_event_ms = write_event_ms;
+  rig.pf.set_write_without_response(no_rsp);
+  rig.start();
+  CHECK(rig.run_until_done());
+  rig.run(100);
+
+  const uint32_t reads0 = rig.sim.stats.per_cmd[210] + rig.sim.stats.per_cmd[211];
+  const uint32_t t0 = host::now_ms;
+  uint32_t total = 0;
+  for (int i = 0; i < REFRESHES; i++) {
+    const uint32_t ms = refresh(rig);
+    CHECK(ms != 0);
+    total += ms;
+  }
+  const uint32_t reads = rig.sim.stats.per_cmd[210] + rig.sim.stats.per_cmd[211] - reads0;
+  CHECK_EQ(reads, 2 * REFRESHES);
+
+  Result r;
+  r.refresh_ms = (total + REFRESHES / 2) / REFRESHES;
+  r.reads_per_s = 1000.0f * reads / float(host::now_ms - t0);
+  return r;
+}
+
+int main() {
+  std::printf("write-complete  RSP refresh  NO_RSP refresh  RSP reads/s  NO_RSP reads/s\n");
+  for (uint32_t wev : {5u, 10u, 20u, 30u}) {
+    const Result rsp = measure(false, wev);
+    const Result burst = measure(true, wev);
+    std::printf("%11u ms  %8u ms  %11u ms  %11.1f  %14.1f\n", (unsigned) wev, (unsigned) rsp.refresh_ms,
+                (unsigned) burst.refresh_ms, rsp.reads_per_s, burst.reads_per_s);
+    CHECK(burst.reads_per_s >= rsp.reads_per_s);
+  }
+  return test::result("burst_bench");
+}
@@ -0,0 +1,217 @@
+// Round trips and parser checks for petkit_codec.h; no ESPHome dependency.
+#include "petkit_codec.h"
+
+#include <cstring>
+#include <vector>
+
+#include "frames.h"
+#include "test_util.h"
+
+using namespace esphome::petkit_fountain;
+using test::Bytes;
+
+static void test_encode_decode_round_trip() {
+  for (size_t len = 0; len <= PETKIT_MAX_PAYLOAD; len++) {
+    Bytes data(len);
+    for (size_t i = 0; i < len; i++) data[i] = (uint8_t) (i * 37 + 1);
+    uint8_t buf[PETKIT_MAX_TX_FRAME];
+    const size_t n = petkit_encode_cmd_(buf, sizeof(buf), (uint8_t) (len + 7), 0xDD, PETKIT_TYPE_REQUEST,
+                                        data.data(), len);
+    CHECK_EQ(n, PETKIT_FRAME_OVERHEAD + len);
+
+    PetkitFrame f;
+    CHECK(petkit_decode_frame_(buf, n, f));
+    CHECK_EQ(f.cmd, 0xDD);
+    CHECK_EQ(f.type, PETKIT_TYPE_REQUEST);
+    CHECK_EQ(f.seq, len + 7);
+    CHECK_EQ(f.data_len, len);
+    CHECK(Bytes(f.data, f.data + f.data_len) == data);
+
+    // one byte short / long never decodes
+    CHECK(!petkit_decode_frame_(buf, n - 1, f));
+  }
+
+  uint8_t small[PETKIT_FRAME_OVERHEAD + 1];
+  const uint8_t two[2] = {1, 2};
+  CHECK_EQ(petkit_encode_cmd_(small, sizeof(small), 0, 0xD2, 1, two, 2), 0);
+}
+
+static void test_decode_rejects_damage() {
+  const Bytes good = test::d3(5);
+  PetkitFrame f;
+  CHECK(petkit_decode_frame_(good.data(), good.size(), f));
+  for (size_t i : {0u, 1u, 2u, 6u}) {
+    Bytes bad = good;
+    bad[i] ^= 0x01;
+    CHECK(!petkit_decode_frame_(bad.data(), bad.size(), f));
+  }
+  Bytes bad = good;
+  bad.back() = 0x00;
+  CHECK(!petkit_decode_frame_(bad.data(), bad.size(), f));
+}
+
+static void test_read_template_matches_encoder() {
+  for (uint8_t cmd : {210, 211, 213}) {
+    PetkitReadTemplate t = petkit_make_read_template_(cmd);
+    t[PETKIT_SEQ_OFFSET] = 9;
+    const uint8_t zero[2] = {0, 0};
+    uint8_t buf[PETKIT_READ_FRAME_LEN];
+    CHECK_EQ(petkit_encode_cmd_(buf, sizeof(buf), 9, cmd, PETKIT_TYPE_REQUEST, zero, 2), PETKIT_READ_FRAME_LEN);
+    CHECK(std::equal(t.begin(), t.end(), buf));
+  }
+}
+
+static void test_config_round_trip() {
+  const Bytes cfg = test::config_bytes(2);
+  const Bytes fr = test::frame(0xD3, PETKIT_TYPE_RESPONSE, 4, cfg);
+  PetkitFrame f;
+  CHECK(petkit_decode_frame_(fr.data(), fr.size(), f));
+  PetkitConfigD3 c = petkit_parse_config_d3_(f);
+  CHECK(c.ok);
+  CHECK_EQ(c.seq, 4);
+  CHECK_EQ(c.smart_on, 3);
+  CHECK_EQ(c.smart_off, 5);
+  CHECK_EQ(c.light_sw, 1);
+  CHECK_EQ(c.brightness, 2);
+  CHECK_EQ(c.light_start, 480);
+  CHECK_EQ(c.light_end, 1350);
+  CHECK_EQ(c.dnd_sw, 1);
+  CHECK_EQ(c.dnd_start, 1350);
+  CHECK_EQ(c.dnd_end, 480);
+
+  // wrong length or type is rejected
+  Bytes shorter(cfg.begin(), cfg.end() - 1);
+  const Bytes fs = test::frame(0xD3, PETKIT_TYPE_RESPONSE, 4, shorter);
+  CHECK(petkit_decode_frame_(fs.data(), fs.size(), f));
+  CHECK(!petkit_parse_config_d3_(f).ok);
+  const Bytes fq = test::frame(0xD3, PETKIT_TYPE_REQUEST, 4, cfg);
+  CHECK(petkit_decode_frame_(fq.data(), fq.size(), f));
+  CHECK(!petkit_parse_config_d3_(f).ok);
+}
+
+static void test_identifiers() {
+  const Bytes fr = test::d5(3, "CTW2SERIAL01");
+  PetkitFrame f;
+  CHECK(petkit_decode_frame_(fr.data(), fr.size(), f));
+  Petkit213Info info = petkit_parse_cmd213_(f);
+  CHECK(info.ok);
+  CHECK_EQ(info.seq, 3);
+  CHECK_EQ(info.device_id_int, 0xA1B2C3D4ULL);
+  CHECK(std::string(info.serial.c_str()) == "CTW2SERIAL01");
+
+  // serial longer than the inline storage is truncated
+  const Bytes lf = test::d5(3, std::string(40, 'X'));
+  CHECK(petkit_decode_frame_(lf.data(), lf.size(), f));
+  CHECK_EQ(petkit_parse_cmd213_(f).serial.size(), PETKIT_SERIAL_MAX);
+
+  const Bytes sf = test::frame(0xD5, 2, 0, {0, 0, 1});
+  CHECK(petkit_decode_frame_(sf.data(), sf.size(), f));
+  CHECK(!petkit_parse_cmd213_(f).ok);
+}
+
+static void test_state_frames() {
+  PetkitFrame f;
+  const Bytes s = test::d2(6, 1);
+  CHECK(petkit_decode_frame_(s.data(), s.size(), f));
+  PetkitStateD2 d2 = petkit_parse_state_d2_(f);
+  CHECK(d2.ok);
+  CHECK_EQ(d2.power, 1);
+  CHECK_EQ(d2.filter_percent, 80);
+  CHECK_EQ(d2.run_status, 1);
+
+  const Bytes full = test::e6(34, 1, 2);
+  CHECK(petkit_decode_frame_(full.data(), full.size(), f));
+  PetkitStateE6 e = petkit_parse_state_e6_t_<PetkitProfileCTW2>(f);
+  CHECK(e.ok);
+  CHECK_EQ(e.pump_runtime, 123456);
+  CHECK_EQ(e.today_runtime, 3600);
+  CHECK_EQ(e.config.brightness, 2);
+  CHECK(e.has_purified_times && e.today_purified_times == 12);
+  CHECK(e.has_energy && e.energy_raw == 42);
+
+  const Bytes bare = test::e6(29);
+  CHECK(petkit_decode_frame_(bare.data(), bare.size(), f));
+  CHECK(!petkit_parse_state_e6_t_<PetkitProfileCTW2>(f).ok);  // CTW2 needs the tail
+  e = petkit_parse_state_e6_t_<PetkitProfileW5>(f);
+  CHECK(e.ok && !e.has_purified_times && !e.has_energy);
+  e = petkit_parse_state_e6_(f);
+  CHECK(e.ok && !e.has_purified_times && !e.has_energy);
+
+  const Bytes partial = test::e6(31);
+  CHECK(petkit_decode_frame_(partial.data(), partial.size(), f));
+  e = petkit_parse_state_e6_(f);
+  CHECK(e.ok && e.has_purified_times && !e.has_energy);
+
+  // auto report: only the lengths a fixed profile reads name one
+  CHECK(std::strcmp(petkit_profile_for_e6_len_(29), "w5") == 0);
+  CHECK(petkit_profile_for_e6_len_(30) == nullptr);
+  CHECK(petkit_profile_for_e6_len_(33) == nullptr);
+  CHECK(std::strcmp(petkit_profile_for_e6_len_(34), "ctw2") == 0);
+}
+
+static void test_ack() {
+  PetkitFrame f;
+  const Bytes a = test::ack(0x49, 7, 1);
+  CHECK(petkit_decode_frame_(a.data(), a.size(), f));
+  PetkitAck ack = petkit_parse_ack_(f);
+  CHECK(ack.ok);
+  CHECK_EQ(ack.cmd, 0x49);
+  CHECK_EQ(ack.seq, 7);
+  CHECK_EQ(ack.value, 1);
+
+  const Bytes empty = test::frame(0x49, 2, 7, {});
+  CHECK(petkit_decode_frame_(empty.data(), empty.size(), f));
+  CHECK(!petkit_parse_ack_(f).ok);
+}
+
+static void test_secret_and_time() {
+  std::array<uint8_t, 8> id8{}, secret{};
+  petkit_compute_secret_(PetkitDeviceId{{0x00, 0x00, 0xA1, 0xB2, 0xC3, 0xD4}}, id8, secret);
+  CHECK((id8 == std::array<uint8_t, 8>{{0, 0, 0, 0, 0xA1, 0xB2, 0xC3, 0xD4}}));
+  // reversed id ends in 00 00, which the device replaces with 13 37
+  CHECK((secret == std::array<uint8_t, 8>{{0, 0, 0xD4, 0xC3, 0xB2, 0xA1, 13, 37}}));
+
+  petkit_compute_secret_(PetkitDeviceId{{1, 2, 3, 4, 5, 6}}, id8, secret);
+  CHECK((secret == std::array<uint8_t, 8>{{0, 0, 6, 5, 4, 3, 2, 1}}));
+
+  const auto t = petkit_build_time_bytes_((time_t) (946684800LL + 0x01020304));
+  CHECK((t == std::array<uint8_t, PETKIT_TIME_PAYLOAD_LEN>{{0, 1, 2, 3, 4, 13}}));
+  const auto unset = petkit_build_time_bytes_((time_t) 1000);
+  CHECK((unset == std::array<uint8_t, PETKIT_TIME_PAYLOAD_LEN>{{0, 0, 0, 0, 0, 13}}));
+}
+
+static void test_capture_ring() {
+  std::array<PetkitCaptureRecord, 3> storage{};
+  PetkitCapture cap;
+  cap.init(storage.data(), storage.size());
+  const Bytes e6 = test::e6(42);
+  for (uint8_t i = 0; i < 5; i++) cap.record(100 + i, PETKIT_CAPTURE_RX, e6.data(), e6.size());
+  CHECK_EQ(cap.size(), 3);
+  CHECK_EQ(cap.get_total(), 5);
+
+  std::vector<uint32_t> order;
+  cap.for_each([&](const PetkitCaptureRecord &r) { order.push_back(r.ms); });
+  CHECK((order == std::vector<uint32_t>{102, 103, 104}));
+
+  char line[PETKIT_CAPTURE_LINE_MAX];
+  cap.for_each([&](const PetkitCaptureRecord &r) {
+    const size_t n = petkit_format_capture_(r, line, sizeof(line));
+    CHECK(n < sizeof(line));
+    CHECK_EQ(r.len, e6.size());
+    CHECK_EQ(r.stored_len, PETKIT_CAPTURE_SLOT);
+  });
+  CHECK(std::string(line).rfind("PKCAP1 104 R 0 51 FAFCFDE6", 0) == 0);
+}
+
+int main() {
+  test_encode_decode_round_trip();
+  test_decode_rejects_damage();
+  test_read_template_matches_encoder();
+  test_config_round_trip();
+  test_identifiers();
+  test_state_frames();
+  test_ack();
+  test_secret_and_time();
+  test_capture_ring();
+  return test::result("codec_test");
+}
@@ -0,0 +1,88 @@
+// Smoke test: the component builds against the host stubs, asks for the identifiers after
+// connecting and publishes an E6 push to its bound sensors.
+#include "petkit_fountain.h"
+
+#include "frames.h"
+#include "host.h"
+#include "test_util.h"
+
+using namespace esphome;
+using namespace esphome::petkit_fountain;
+
+static void notify(PetkitFountain &pf, test::Bytes v) {
+  esp_ble_gattc_cb_param_t p{};
+  p.notify.handle = 0x10;
+  p.notify.value = v.data();
+  p.notify.value_len = (uint16_t) v.size();
+  pf.gattc_event_handler(ESP_GATTC_NOTIFY_EVT, 3, &p);
+}
+
+static void event(PetkitFountain &pf, esp_gattc_cb_event_t e) {
+  esp_ble_gattc_cb_param_t p{};
+  pf.gattc_event_handler(e, 3, &p);
+}
+
+int main() {
+  host::reset();
+  ble_client::BLEClient client;
+  client.add_characteristic(esp32_ble::ESPBTUUID::from_raw("notify"), 0x10);
+  client.add_characteristic(esp32_ble::ESPBTUUID::from_raw("write"), 0x12);
+
+  PetkitFountain pf("service", "notify", "write");
+  sensor::Sensor filter, brightness, brightness2;
+  pf.bind_sensor(FIELD_BRIGHTNESS, &brightness2);
+  pf.bind_sensor(FIELD_FILTER_PERCENT, &filter);
+  pf.bind_sensor(FIELD_BRIGHTNESS, &brightness);
+  pf.set_ble_client_parent(&client);
+  pf.setup();
+
+  event(pf, ESP_GATTC_OPEN_EVT);
+  event(pf, ESP_GATTC_SEARCH_CMPL_EVT);
+  event(pf, ESP_GATTC_WRITE_DESCR_EVT);
+  for (int i = 0; i < 20; i++) {
+    host::advance(100);
+    pf.loop();
+  }
+  CHECK_EQ(host::writes.size(), 1);
+  if (!host::writes.empty()) {
+    CHECK_EQ(host::writes[0].handle, 0x12);
+    CHECK_EQ(host::writes[0].value[3], 213);
+  }
+
+  notify(pf, test::e6(34, 1, 2));
+  CHECK_EQ(filter.state, 80);
+  CHECK_EQ(brightness.state, 2);
+  CHECK_EQ(brightness2.state, 2);
+  CHECK_EQ(filter.publishes, 1);
+
+  // same push again: the publish cache suppresses unchanged values
+  notify(pf, test::e6(34, 1, 2));
+  CHECK_EQ(filter.publishes, 1);
+  CHECK_EQ(brightness.publishes, 1);
+  CHECK_EQ(brightness2.publishes, 1);
+
+  // link summary only when its text sensor is bound
+  text_sensor::TextSensor summary;
+  pf.update();
+  CHECK_EQ(summary.publishes, 0);
+  pf.set_link_summary_text_sensor(&summary);
+  pf.update();
+  CHECK_EQ(summary.publishes, 1);
+  CHECK(summary.state.rfind("tx=1 rx=2", 0) == 0);
+
+  // the registry is fixed-size: a binding past PETKIT_BINDING_CAPACITY is dropped, not grown
+  {
+    PetkitFountain full("service", "notify", "write");
+    std::vector<sensor::Sensor> fill(PETKIT_BINDING_CAPACITY);
+    for (auto &s : fill) full.bind_sensor(FIELD_FILTER_PERCENT, &s);
+    sensor::Sensor extra;
+    full.bind_sensor(FIELD_POWER, &extra);
+    full.set_ble_client_parent(&client);
+    full.setup();
+    notify(full, test::e6(34, 1, 2));
+    CHECK_EQ(fill.back().publishes, 1);
+    CHECK_EQ(extra.publishes, 0);
+  }
+
+  return test::result("component_test");
+}
@@ -0,0 +1,88 @@
+// CMD221 batches waiting for their CMD211 baseline.
+#include "sim_rig.h"
+#include "test_util.h"
+
+using test::SimRig;
+
+// The baseline read goes unanswered for a while: the batch re-requests it and is sent once
+// a D3 arrives.
+static void test_baseline_retried_until_answered() {
+  SimRig rig;
+  rig.sim.link.ignore_cmd = 211;
+  rig.start();
+  rig.run(6000);  // the init chain's CMD211 has given up
+  rig.pf.set_brightness(2);
+  rig.run(2000);
+  CHECK_EQ(rig.sim.stats.per_cmd[221], 0);
+  CHECK(rig.pf.has_pending_writes());
+
+  rig.sim.link.ignore_cmd = 0;
+  rig.run(4000);
+  CHECK_EQ(rig.sim.stats.per_cmd[221], 1);
+  CHECK_EQ(rig.sim.state.config[3], 2);
+  CHECK(!rig.pf.has_pending_writes());
+}
+
+// A device that never answers CMD211: the batch is given up instead of staying staged.
+static void test_baseline_gives_up() {
+  SimRig rig;
+  rig.sim.link.ignore_cmd = 211;
+  rig.start();
+  rig.run(6000);
+  const uint32_t reads = rig.sim.stats.per_cmd[211];
+  rig.pf.set_brightness(2);
+  rig.run(10000);
+  CHECK_EQ(rig.sim.stats.per_cmd[221], 0);
+  CHECK(!rig.pf.has_pending_writes());
+  // three requests of three attempts each, then nothing more
+  CHECK_EQ(rig.sim.stats.per_cmd[211] - reads, 9);
+  rig.run(10000);
+  CHECK_EQ(rig.sim.stats.per_cmd[211] - reads, 9);
+}
+
+// A change staged before the session is merged over the device's current config (the init
+// chain's CMD211), not over the baseline from the previous session.
+static void test_batch_waits_for_fresh_baseline() {
+  SimRig rig;
+  rig.start();
+  CHECK(rig.run_until_done());
+  rig.disconnect();
+
+  rig.sim.state.config[0] = 7;  // changed on the device, e.g. from the app
+  rig.pf.set_brightness(2);
+  rig.run(2000);
+  CHECK_EQ(rig.sim.stats.per_cmd[221], 0);  // nothing goes out while disconnected
+
+  rig.connect();
+  CHECK(rig.run_until_done());
+  CHECK_EQ(rig.sim.stats.per_cmd[221], 1);
+  CHECK_EQ(rig.sim.state.config[0], 7);
+  CHECK_EQ(rig.sim.state.config[3], 2);
+}
+
+// Same with a baseline restored from flash after a reboot.
+static void test_flash_baseline_not_written_back() {
+  {
+    SimRig first;
+    first.start();
+    CHECK(first.run_until_done());
+    first.run(1000);  // config saved to flash
+  }
+
+  SimRig rig(true);
+  rig.sim.state.config[0] = 7;
+  rig.start();
+  rig.pf.set_brightness(2);
+  CHECK(rig.run_until_done());
+  CHECK_EQ(rig.sim.stats.per_cmd[221], 1);
+  CHECK_EQ(rig.sim.state.config[0], 7);
+  CHECK_EQ(rig.sim.state.config[3], 2);
+}
+
+int main() {
+  test_baseline_retried_until_answered();
+  test_baseline_gives_up();
+  test_batch_waits_for_fresh_baseline();
+  test_flash_baseline_not_written_back();
+  return test::result("config_test");
+}
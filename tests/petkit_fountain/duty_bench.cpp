@@ -0,0 +1,53 @@
+// Duty-cycled connection against the simulated fountain: connected-time fraction, session
+// length and the delay of a change made while disconnected. The README figures come from
+// this output.
+#include <cstdio>
+
+#include "sim_rig.h"
+#include "test_util.h"
+
+using test::SimRig;
+
+static void measure(uint32_t interval_ms) {
+  SimRig rig;
+  esphome::sensor::Sensor fraction;
+  rig.pf.bind_sensor(esphome::petkit_fountain::FIELD_CONNECTED_FRACTION, &fraction);
+  rig.pf.set_duty_cycle_interval(interval_ms);
+  rig.start();
+  CHECK(!rig.connected());
+
+  const uint32_t run_ms = 30 * 60 * 1000;
+  rig.run(run_ms / 2);
+
+  // a change while disconnected brings the next session forward
+  while (rig.connected()) rig.run(1);
+  rig.run(1000);
+  const uint32_t t0 = host::now_ms;
+  rig.pf.set_power(false);
+  uint32_t write_ms = 0;
+  for (uint32_t i = 0; i < 10000 && write_ms == 0; i++) {
+    rig.run(1);
+    if (rig.sim.state.power == 0) write_ms = host::now_ms - t0;
+  }
+  CHECK(write_ms != 0);
+  rig.run(run_ms / 2);
+  rig.pf.update();
+
+  uint32_t total = 0, done = 0;
+  for (const auto &s : rig.sessions) {
+    if (s.done_ms != 0) done++;
+    total += s.connected_ms;
+  }
+  CHECK_EQ(done, rig.sessions.size() - (rig.connected() ? 1 : 0));
+  const float mean_s = rig.sessions.empty() ? 0 : total / 1000.0f / rig.sessions.size();
+  std::printf("interval %3us: sessions=%zu mean session=%.2fs connected=%.2f%% (sensor %.1f%%) change delay=%ums\n",
+              (unsigned) (interval_ms / 1000), rig.sessions.size(), mean_s, 100.0f * rig.connected_fraction(),
+              fraction.state, (unsigned) write_ms);
+  CHECK(rig.connected_fraction() < 0.05f);
+}
+
+int main() {
+  measure(60 * 1000);
+  measure(5 * 60 * 1000);
+  return test::result("duty_bench");
+}
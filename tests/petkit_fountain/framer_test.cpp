@@ -0,0 +1,104 @@
+// PetkitFramer: reassembly across notifications, garbage and bogus headers.
+#include "petkit_codec.h"
+
+#include <vector>
+
+#include "frames.h"
+#include "test_util.h"
+
+using namespace esphome::petkit_fountain;
+using test::Bytes;
+
+struct Sink {
+  std::vector<Bytes> frames;
+  void operator()(const uint8_t *f, size_t len) { frames.emplace_back(f, f + len); }
+};
+
+static Bytes cat(std::initializer_list<Bytes> parts) {
+  Bytes out;
+  for (const auto &p : parts) out.insert(out.end(), p.begin(), p.end());
+  return out;
+}
+
+static void feed(PetkitFramer &fr, const Bytes &b, uint32_t now, Sink &sink) {
+  fr.feed(b.data(), b.size(), now, [&](const uint8_t *f, size_t len) { sink(f, len); });
+}
+
+static void test_split_and_shared_notifications() {
+  PetkitFramer fr;
+  Sink sink;
+  const Bytes stream = cat({test::e6(34), test::d3(1), test::ack(0x49, 2)});
+  // 20-byte ATT chunks: E6 spans three notifications, D3 and the ACK share one
+  for (size_t off = 0; off < stream.size(); off += 20) {
+    Bytes chunk(stream.begin() + off, stream.begin() + std::min(stream.size(), off + 20));
+    feed(fr, chunk, 100, sink);
+  }
+  CHECK_EQ(sink.frames.size(), 3);
+  if (sink.frames.size() == 3) {
+    CHECK(sink.frames[0] == test::e6(34));
+    CHECK(sink.frames[1] == test::d3(1));
+    CHECK(sink.frames[2] == test::ack(0x49, 2));
+  }
+  CHECK(fr.get_reassembled() >= 1);
+  CHECK_EQ(fr.get_dropped(), 0);
+}
+
+static void test_garbage_between_frames() {
+  PetkitFramer fr;
+  Sink sink;
+  feed(fr, cat({{0x00, 0x13, 0xFA, 0x01}, test::d3(1), {0xFB, 0xFA}, test::ack(0xDD, 3)}), 100, sink);
+  CHECK_EQ(sink.frames.size(), 2);
+}
+
+// A header with a corrupted length byte must not swallow the frames behind it.
+static void test_bogus_length_header() {
+  PetkitFramer fr;
+  Sink sink;
+  const Bytes bogus = {0xFA, 0xFC, 0xFD, 0x01, 0x02, 0x03, 0x60, 0x00};
+  feed(fr, cat({bogus, test::d3(1), test::ack(0x49, 2)}), 100, sink);
+  CHECK_EQ(sink.frames.size(), 2);
+  if (sink.frames.size() == 2) {
+    CHECK(sink.frames[0] == test::d3(1));
+    CHECK(sink.frames[1] == test::ack(0x49, 2));
+  }
+  CHECK_EQ(fr.get_dropped(), 1);
+}
+
+// Length within the command's bound: the frames behind it come out once the candidate goes
+// stale, ahead of the next notification's frame.
+static void test_stale_candidate_is_rescanned() {
+  PetkitFramer fr;
+  Sink sink;
+  const Bytes bogus = {0xFA, 0xFC, 0xFD, 0xE6, 0x02, 0x00, 0x3C, 0x00};
+  feed(fr, cat({bogus, test::d3(1), test::ack(0x49, 2)}), 100, sink);
+  CHECK_EQ(sink.frames.size(), 0);
+
+  feed(fr, test::d2(4), 100 + 3000, sink);
+  CHECK_EQ(sink.frames.size(), 3);
+  if (sink.frames.size() == 3) {
+    CHECK(sink.frames[0] == test::d3(1));
+    CHECK(sink.frames[1] == test::ack(0x49, 2));
+    CHECK(sink.frames[2] == test::d2(4));
+  }
+  CHECK_EQ(fr.get_dropped(), 1);
+}
+
+// A genuinely truncated frame is still given up after STALE_MS.
+static void test_stale_partial_dropped() {
+  PetkitFramer fr;
+  Sink sink;
+  const Bytes e6 = test::e6(34);
+  feed(fr, Bytes(e6.begin(), e6.begin() + 20), 100, sink);
+  feed(fr, test::d3(1), 100 + PetkitFramer::STALE_MS + 1, sink);
+  CHECK_EQ(sink.frames.size(), 1);
+  CHECK_EQ(fr.get_dropped(), 1);
+}
+
+int main() {
+  test_split_and_shared_notifications();
+  test_garbage_between_frames();
+  test_bogus_length_header();
+  test_stale_candidate_is_rescanned();
+  test_stale_partial_dropped();
+  return test::result("framer_test");
+}
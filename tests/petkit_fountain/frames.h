@@ -0,0 +1,59 @@
+#pragma once
+// Frame builders shared by the host tests.
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "petkit_codec.h"
+
+namespace test {
+
+using Bytes = std::vector<uint8_t>;
+
+inline Bytes frame(uint8_t cmd, uint8_t type, uint8_t seq, const Bytes &data) {
+  Bytes out(esphome::petkit_fountain::PETKIT_FRAME_OVERHEAD + data.size());
+  out.resize(esphome::petkit_fountain::petkit_encode_cmd_(out.data(), out.size(), seq, cmd, type, data.data(),
+                                                          data.size()));
+  return out;
+}
+
+inline Bytes config_bytes(uint8_t brightness = 1) {
+  return {3, 5, 1, brightness, 0x01, 0xE0, 0x05, 0x46, 1, 0x05, 0x46, 0x01, 0xE0};
+}
+
+inline Bytes d5(uint8_t seq = 0, const std::string &serial = "CTW2SERIAL01") {
+  Bytes d = {0, 0, 0, 0, 0xA1, 0xB2, 0xC3, 0xD4};
+  d.insert(d.end(), serial.begin(), serial.end());
+  return frame(0xD5, 2, seq, d);
+}
+
+inline Bytes d2(uint8_t seq = 0, uint8_t power = 1) {
+  Bytes d(12, 0);
+  d[0] = power;
+  d[1] = 1;
+  d[10] = 80;
+  d[11] = 1;
+  return frame(0xD2, 2, seq, d);
+}
+
+inline Bytes d3(uint8_t seq = 0, uint8_t brightness = 1) { return frame(0xD3, 2, seq, config_bytes(brightness)); }
+
+// E6 push; `len` 29 ends after the settings block, 34 carries purified times + energy.
+inline Bytes e6(size_t len = 34, uint8_t power = 1, uint8_t brightness = 1) {
+  Bytes d(len, 0);
+  d[0] = power;
+  d[1] = 1;
+  d[6] = 0x00, d[7] = 0x01, d[8] = 0xE2, d[9] = 0x40;  // pump runtime 123456
+  d[10] = 80;
+  d[11] = 1;
+  d[12] = 0x00, d[13] = 0x00, d[14] = 0x0E, d[15] = 0x10;  // today 3600
+  Bytes cfg = config_bytes(brightness);
+  std::copy(cfg.begin(), cfg.end(), d.begin() + 16);
+  if (len > 29) d[29] = 12;
+  if (len >= 34) d[33] = 42;
+  return frame(0xE6, 2, 0, d);
+}
+
+inline Bytes ack(uint8_t cmd, uint8_t seq, uint8_t status = 1) { return frame(cmd, 2, seq, {status}); }
+
+}  // namespace test
@@ -0,0 +1,51 @@
+// Fuzz target: PetkitFramer::feed over an arbitrary notification stream.
+// - The stream fed in one chunk and in chunks of 1..16 bytes (at one timestamp) must give the
+//   same frames: reassembly does not depend on how the link cut the notifications.
+// - Every emitted frame is well formed by the reference decoder and within the length the
+//   framer accepts for its command.
+// - Fed with gaps past STALE_MS, only these per-frame properties are checked (resync may drop).
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "reference_decoder.h"
+
+using esphome::petkit_fountain::PetkitFramer;
+
+static void fail(const char *what) {
+  std::fprintf(stderr, "framer: %s\n", what);
+  std::abort();
+}
+
+static void check_frame(const uint8_t *frame, size_t len) {
+  const ref::Frame r = ref::decode(ref::Bytes(frame, frame + len));
+  if (!r.ok) fail("emitted a frame the reference decoder rejects");
+  if (r.data.size() > esphome::petkit_fountain::petkit_max_data_len_(r.cmd)) fail("emitted an over-long frame");
+}
+
+// Feeds `data` in chunks whose sizes come from `seed`; `gap_ms` between chunks.
+static std::vector<ref::Bytes> run(const uint8_t *data, size_t size, uint32_t seed, size_t max_chunk,
+                                   uint32_t gap_ms) {
+  PetkitFramer framer;
+  std::vector<ref::Bytes> frames;
+  uint32_t now = 0;
+  for (size_t pos = 0; pos < size;) {
+    seed = seed * 1103515245u + 12345u;
+    const size_t n = std::min<size_t>(size - pos, 1 + (seed >> 16) % max_chunk);
+    framer.feed(data + pos, n, now, [&](const uint8_t *frame, size_t len) {
+      check_frame(frame, len);
+      frames.emplace_back(frame, frame + len);
+    });
+    pos += n;
+    now += gap_ms;
+  }
+  return frames;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  const uint32_t seed = uint32_t(size) * 2654435761u ^ (size ? data[size / 2] : 0);
+  const auto whole = run(data, size, seed, size ? size : 1, 0);
+  if (run(data, size, seed, 16, 0) != whole) fail("frames depend on the chunking");
+  run(data, size, seed, 16, PetkitFramer::STALE_MS + 1);
+  return 0;
+}
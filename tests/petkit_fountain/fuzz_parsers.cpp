@@ -0,0 +1,26 @@
+// Fuzz target: petkit_decode_frame_ and every petkit_parse_*_ (each model profile), checked
+// against the bounds-checked reference decoder. Any difference aborts with the first mismatch.
+// Each input is checked as is and, so that most inputs reach the parsers, once more wrapped
+// into a well-formed frame (cmd, type, seq from the first three bytes, the rest as data).
+#include <cstdio>
+#include <cstdlib>
+
+#include "reference_decoder.h"
+
+static void check(const uint8_t *data, size_t size) {
+  const ref::Diff d = ref::frame(data, size);
+  if (d.count() == 0) return;
+  std::fprintf(stderr, "codec differs from the reference decoder: %s\n", d.first().c_str());
+  std::abort();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  check(data, size);
+  if (size < 3) return 0;
+  const size_t n = std::min<size_t>(size - 3, 255);
+  ref::Bytes f = {0xFA, 0xFC, 0xFD, data[0], data[1], data[2], uint8_t(n), 0x00};
+  f.insert(f.end(), data + 3, data + 3 + n);
+  f.push_back(0xFB);
+  check(f.data(), f.size());
+  return 0;
+}
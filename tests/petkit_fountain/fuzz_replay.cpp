@@ -0,0 +1,39 @@
+// Standalone driver for a fuzz target, so the targets also run under ctest without libFuzzer.
+//   <target>_replay             seeds, then deterministic mutations (default 200000)
+//   <target>_replay N           N mutations
+//   <target>_replay file...     replays inputs, e.g. a crash file libFuzzer wrote
+// Mutated inputs that are well-formed frames join the corpus, so later mutations build on them.
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#include "fuzz_seeds.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int main(int argc, char **argv) {
+  if (argc > 1 && std::atol(argv[1]) == 0) {
+    for (int i = 1; i < argc; i++) {
+      std::ifstream in(argv[i], std::ios::binary);
+      const test::Bytes x((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+      LLVMFuzzerTestOneInput(x.data(), x.size());
+      std::printf("%s: ok (%zu bytes)\n", argv[i], x.size());
+    }
+    return 0;
+  }
+  const long iterations = argc > 1 ? std::atol(argv[1]) : 200000;
+  auto corpus = test::fuzz_seeds();
+  for (const auto &s : corpus) LLVMFuzzerTestOneInput(s.data(), s.size());
+
+  std::mt19937 rng(12345);
+  for (long i = 0; i < iterations; i++) {
+    const test::Bytes x = test::fuzz_mutate(corpus, rng);
+    LLVMFuzzerTestOneInput(x.data(), x.size());
+    esphome::petkit_fountain::PetkitFrame f;
+    if (corpus.size() < 4096 && rng() % 64 == 0 && esphome::petkit_fountain::petkit_decode_frame_(x.data(), x.size(), f))
+      corpus.push_back(x);
+  }
+  std::printf("%ld mutated inputs, corpus %zu: ok\n", iterations, corpus.size());
+  return 0;
+}
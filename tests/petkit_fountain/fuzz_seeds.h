@@ -0,0 +1,56 @@
+#pragma once
+// Seed frames and a deterministic mutator shared by the fuzz replay drivers and parser_bench.
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "frames.h"
+
+namespace test {
+
+inline std::vector<Bytes> fuzz_seeds() {
+  std::vector<Bytes> s = {d5(), d5(1, "W5SERIAL-0123456789-ABCDEFGH"), d2(), d3(), e6(29), e6(31), e6(34)};
+  for (uint8_t cmd : {0x49, 0x54, 0x56, 0xDC, 0xDD, 0xDE}) s.push_back(ack(cmd, 3));
+  // captured with packet_capture: a CMD211 request echo and a real D3 reply
+  s.push_back({0xFA, 0xFC, 0xFD, 0xD3, 0x01, 0x05, 0x02, 0x00, 0x00, 0x00, 0xFB});
+  s.push_back({0xFA, 0xFC, 0xFD, 0xD3, 0x02, 0x05, 0x0D, 0x00, 0x03, 0x05, 0x01, 0x01, 0x00,
+               0x00, 0x05, 0x9F, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFB});
+  return s;
+}
+
+// One to four edits: bit flips, byte overwrites, length-byte rewrites (random or matching
+// the frame), truncation, appended bytes and splicing with another corpus entry.
+inline Bytes fuzz_mutate(const std::vector<Bytes> &corpus, std::mt19937 &rng) {
+  Bytes x = corpus[rng() % corpus.size()];
+  const int edits = 1 + rng() % 4;
+  for (int m = 0; m < edits; m++) {
+    switch (rng() % 7) {
+      case 0:
+        if (!x.empty()) x[rng() % x.size()] ^= uint8_t(1u << (rng() % 8));
+        break;
+      case 1:
+        if (x.size() > 6) x[6] = uint8_t(rng());
+        break;
+      case 2:
+        if (!x.empty()) x.resize(rng() % x.size());
+        break;
+      case 3:
+        x.push_back(uint8_t(rng()));
+        break;
+      case 4: {
+        const Bytes &y = corpus[rng() % corpus.size()];
+        x.insert(x.end(), y.begin(), y.end());
+        break;
+      }
+      case 5:
+        if (!x.empty()) x[rng() % x.size()] = uint8_t(rng());
+        break;
+      case 6:
+        if (x.size() >= 9) x[6] = uint8_t(x.size() - 9);
+        break;
+    }
+  }
+  return x;
+}
+
+}  // namespace test
@@ -0,0 +1,98 @@
+// Zero-allocation steady state. Global operator new is replaced with a counter, and this file
+// stands in for petkit_alloc_probe.cpp (built with USE_PETKIT_ALLOC_PROBE), so the component's
+// rx/tx heap sensors read the same counts. After warm-up, a connected session with polls, E6
+// pushes, refreshes and coalesced CMD221 writes must not allocate anywhere in the component.
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "host.h"
+#include "sim_rig.h"
+#include "test_util.h"
+
+using namespace esphome;
+using namespace esphome::petkit_fountain;
+
+static PetkitAllocCount g_totals;       // operator new calls outside stub bookkeeping
+static uint32_t g_component_allocs = 0;  // of those, made during a call into the component
+static bool g_in_component = false;
+
+void *operator new(size_t n) {
+  void *p = std::malloc(n ? n : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  if (host::stub_busy == 0) {
+    g_totals.allocs++;
+    g_totals.bytes += uint32_t(n);
+    if (g_in_component) g_component_allocs++;
+  }
+  return p;
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+namespace esphome {
+namespace petkit_fountain {
+PetkitAllocCount petkit_alloc_probe_begin() { return g_totals; }
+PetkitAllocCount petkit_alloc_probe_totals() { return g_totals; }
+}  // namespace petkit_fountain
+}  // namespace esphome
+
+// A minute of a busy link: a change every 10 s (alternating brightness), a refresh every
+// 15 s, an unsolicited E6 every 5 s, polls at the 5 s update interval.
+static void busy_minute(test::SimRig &rig, uint8_t &brightness) {
+  for (uint32_t s = 0; s < 60; s++) {
+    if (s % 10 == 0) {
+      brightness = brightness == 1 ? 2 : 1;
+      rig.component_call(true);
+      rig.pf.set_brightness(brightness);
+      rig.component_call(false);
+    }
+    if (s % 15 == 0) {
+      rig.component_call(true);
+      rig.pf.do_action(PetkitActionButton::REFRESH);
+      rig.component_call(false);
+    }
+    if (s % 5 == 0) rig.sim.push_state(host::now_ms + 100);
+    rig.run(1000);
+  }
+}
+
+int main() {
+  test::SimRig rig;
+  sensor::Sensor rx_allocs, tx_allocs, rx_frames;
+  rig.pf.bind_sensor(FIELD_RX_HEAP_ALLOCS, &rx_allocs);
+  rig.pf.bind_sensor(FIELD_TX_HEAP_ALLOCS, &tx_allocs);
+  rig.pf.bind_sensor(FIELD_RX_FRAMES, &rx_frames);
+  rig.pf.set_update_interval(5000);
+  rig.component_call = [](bool inside) { g_in_component = inside; };
+  rig.start();
+
+  // warm-up: init chain, first config read-back, first flash saves, first log lines
+  uint8_t brightness = 1;
+  busy_minute(rig, brightness);
+  CHECK(rig.connected());
+  const uint32_t warm_component = g_component_allocs;
+  const float warm_rx = rx_allocs.state, warm_tx = tx_allocs.state, warm_frames = rx_frames.state;
+  std::printf("warm-up: %u allocation(s) in the component (rx handlers %.0f, tx writes %.0f)\n",
+              (unsigned) warm_component, warm_rx, warm_tx);
+
+  for (int i = 0; i < 5; i++) busy_minute(rig, brightness);
+  const uint32_t steady = g_component_allocs - warm_component;
+  std::printf("steady state: %.0f frames received, %u allocation(s) in the component\n",
+              rx_frames.state - warm_frames, (unsigned) steady);
+
+  CHECK(rx_frames.state - warm_frames >= 100);  // the link was busy
+  CHECK_EQ(steady, 0);
+  CHECK_EQ(rx_allocs.state, warm_rx);
+  CHECK_EQ(tx_allocs.state, warm_tx);
+
+  // the probe sees transient allocations: a handler that allocates and frees is counted
+  const PetkitAllocCount before = petkit_alloc_probe_begin();
+  int *volatile transient = new int(1);  // volatile: the new/delete pair must not be elided
+  delete transient;
+  PetkitHeapStats::Side side;
+  CHECK_EQ(PetkitHeapStats::account(side, before, petkit_alloc_probe_totals()), 1);
+  CHECK_EQ(side.bytes, sizeof(int));
+
+  return test::result("heap_test");
+}
@@ -0,0 +1,117 @@
+// In-flight table outcomes as seen by the on_done hooks: ACK-less firmware, NAKs, CMD222.
+#include "sim_rig.h"
+#include "test_util.h"
+
+using test::SimRig;
+
+// No ACKs at all: a CMD220 write is unconfirmed, not failed, so no read-back is triggered.
+static void test_ack_less_write_is_not_a_failure() {
+  SimRig rig;
+  rig.sim.link.ack_writes = false;
+  rig.start();
+  rig.run(8000);
+  CHECK(rig.pf.is_session_connected());
+
+  const uint32_t reads = rig.sim.stats.per_cmd[210];
+  rig.pf.set_power(false);
+  rig.run(3000);
+  CHECK_EQ(rig.sim.stats.per_cmd[220], 1);  // sent once, no retries without ACKs
+  CHECK_EQ(rig.sim.stats.per_cmd[210], reads);
+}
+
+// A NAK is an answer, but the write did not take: re-read the state.
+static void test_nak_counts_as_not_answered() {
+  SimRig rig;
+  rig.sim.link.nak_cmd = 220;
+  rig.start();
+  CHECK(rig.run_until_done());
+
+  const uint32_t reads = rig.sim.stats.per_cmd[210];
+  rig.pf.set_power(false);
+  rig.run(2000);
+  CHECK_EQ(rig.sim.stats.per_cmd[220], 1);  // a NAK is not retried
+  CHECK_EQ(rig.sim.stats.per_cmd[210], reads + 1);
+}
+
+// ACKed write: nothing extra.
+static void test_acked_write() {
+  SimRig rig;
+  rig.start();
+  CHECK(rig.run_until_done());
+
+  const uint32_t reads = rig.sim.stats.per_cmd[210];
+  rig.pf.set_power(false);
+  rig.run(2000);
+  CHECK_EQ(rig.sim.stats.per_cmd[220], 1);
+  CHECK_EQ(rig.sim.stats.per_cmd[210], reads);
+  CHECK_EQ(rig.sim.state.power, 0);
+}
+
+// CMD222 (filter reset) is tracked like the other writes: its ACK completes it, a NAK
+// re-reads the state and a lost ACK is retried.
+static void test_filter_reset_is_tracked() {
+  using esphome::petkit_fountain::PetkitActionButton;
+  {
+    SimRig rig;
+    esphome::sensor::Sensor unhandled;
+    rig.pf.bind_sensor(esphome::petkit_fountain::FIELD_UNHANDLED_FRAMES, &unhandled);
+    rig.start();
+    CHECK(rig.run_until_done());
+    const uint32_t reads = rig.sim.stats.per_cmd[210];
+    rig.pf.do_action(PetkitActionButton::RESET_FILTER);
+    rig.run(2000);
+    CHECK_EQ(rig.sim.stats.per_cmd[222], 1);
+    CHECK_EQ(rig.sim.stats.per_cmd[210], reads);
+    CHECK_EQ(rig.sim.state.filter_percent, 100);
+    rig.run(60000);  // metrics are published periodically
+    CHECK(!(unhandled.state > 0));
+  }
+  {
+    SimRig rig;
+    rig.sim.link.nak_cmd = 222;
+    rig.start();
+    CHECK(rig.run_until_done());
+    const uint32_t reads = rig.sim.stats.per_cmd[210];
+    rig.pf.do_action(PetkitActionButton::RESET_FILTER);
+    rig.run(2000);
+    CHECK_EQ(rig.sim.stats.per_cmd[222], 1);
+    CHECK_EQ(rig.sim.stats.per_cmd[210], reads + 1);
+  }
+  {
+    SimRig rig;
+    rig.start();
+    CHECK(rig.run_until_done());
+    rig.sim.link.ignore_cmd = 222;
+    rig.pf.do_action(PetkitActionButton::RESET_FILTER);
+    rig.run(10000);
+    CHECK(rig.sim.stats.per_cmd[222] > 1);  // lost ACK: sent again
+  }
+}
+
+// Adaptive polling uses the fast rate while a write waits for its ACK, here a CMD222 whose
+// ACK is lost: polls go out before the retries give up and trigger the re-read.
+static void test_unconfirmed_write_polls_fast() {
+  SimRig rig;
+  rig.sim.state.run_status = 0;  // pump idle: idle polling interval
+  rig.pf.set_update_interval(1000);
+  rig.start();
+  CHECK(rig.run_until_done());
+  rig.run(30000);
+  const uint32_t reads = rig.sim.stats.per_cmd[210];
+  rig.run(30000);
+  CHECK_EQ(rig.sim.stats.per_cmd[210], reads);  // idle: no polls
+
+  rig.sim.link.ignore_cmd = 222;
+  rig.pf.do_action(esphome::petkit_fountain::PetkitActionButton::RESET_FILTER);
+  rig.run(2000);  // < 3 x 750 ms, the CMD222 is still in flight
+  CHECK(rig.sim.stats.per_cmd[210] > reads);
+}
+
+int main() {
+  test_ack_less_write_is_not_a_failure();
+  test_nak_counts_as_not_answered();
+  test_acked_write();
+  test_filter_reset_is_tracked();
+  test_unconfirmed_write_polls_fast();
+  return test::result("inflight_test");
+}
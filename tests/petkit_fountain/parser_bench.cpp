@@ -0,0 +1,67 @@
+// Decode + parse throughput on the host. The corpus is the fuzz seeds plus well-formed
+// mutations of them (fuzz_seeds.h); each frame goes through petkit_decode_frame_ and the
+// parser the dispatch table would pick, and the same bytes as one stream through
+// PetkitFramer. Prints frames/s; the README figures come from this output at RelWithDebInfo.
+#include <chrono>
+#include <cstdio>
+
+#include "fuzz_seeds.h"
+#include "test_util.h"
+
+using namespace esphome::petkit_fountain;
+
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main() {
+  auto corpus = test::fuzz_seeds();
+  std::mt19937 rng(12345);
+  while (corpus.size() < 1024) {
+    const test::Bytes x = test::fuzz_mutate(corpus, rng);
+    PetkitFrame f;
+    if (petkit_decode_frame_(x.data(), x.size(), f) && f.data_len <= petkit_max_data_len_(f.cmd)) corpus.push_back(x);
+  }
+  test::Bytes stream;
+  for (const auto &c : corpus) stream.insert(stream.end(), c.begin(), c.end());
+
+  constexpr int REPS = 2000;
+  volatile uint32_t sink = 0;
+  uint32_t parsed = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < REPS; r++) {
+    for (const auto &c : corpus) {
+      PetkitFrame f;
+      if (!petkit_decode_frame_(c.data(), c.size(), f)) continue;
+      parsed++;
+      switch (f.cmd) {
+        case 0xE6: sink = sink + petkit_parse_state_e6_(f).pump_runtime; break;
+        case 0xD2: sink = sink + petkit_parse_state_d2_(f).power; break;
+        case 0xD3: sink = sink + petkit_parse_config_d3_(f).brightness; break;
+        case 0xD5: sink = sink + petkit_parse_cmd213_(f).serial.size(); break;
+        default: sink = sink + petkit_parse_ack_(f).value; break;
+      }
+    }
+  }
+  const double parse_s = seconds_since(t0);
+  CHECK_EQ(parsed, REPS * corpus.size());
+
+  uint32_t framed = 0;
+  t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < REPS; r++) {
+    PetkitFramer framer;
+    // 20-byte chunks, the default ATT payload
+    for (size_t pos = 0; pos < stream.size(); pos += 20) {
+      framer.feed(stream.data() + pos, std::min<size_t>(20, stream.size() - pos), 0,
+                  [&](const uint8_t *, size_t) { framed++; });
+    }
+  }
+  const double framer_s = seconds_since(t0);
+  CHECK_EQ(framed, REPS * corpus.size());
+
+  std::printf("corpus: %zu frames, %zu bytes\n", corpus.size(), stream.size());
+  std::printf("decode + parse: %.1f M frames/s\n", parsed / parse_s / 1e6);
+  std::printf("framer (20-byte chunks): %.1f M frames/s, %.0f MB/s\n", framed / framer_s / 1e6,
+              double(REPS) * stream.size() / framer_s / 1e6);
+  return test::result("parser_bench");
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+// Software Petkit fountain (device side of the protocol) for host-side runs.
+//
+// Test-only: sim_rig.h feeds it the frames the component writes and delivers its
+// notifications back through the stubbed ble_client / esp_ble_gattc_* surface, with a
+// clock it controls. Built only on petkit_codec.h, so it has no ESP-IDF or ESPHome
+// dependency.
+
+#include "petkit_codec.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+namespace petkit_fountain {
+
+class PetkitSimFountain {
+ public:
+  struct State {
+    uint8_t power{1};
+    uint8_t mode{1};
+    uint8_t night_dnd{0};
+    uint8_t breakdown_warn{0};
+    uint8_t lack_warn{0};
+    uint8_t filter_warn{0};
+    uint32_t pump_runtime{123456};
+    uint8_t filter_percent{80};
+    uint8_t run_status{1};
+    uint32_t today_runtime{3600};
+    // CMD221 layout, see petkit_decode_config_()
+    std::array<uint8_t, PETKIT_CONFIG_LEN> config{{3, 5, 1, 1, 0x01, 0xE0, 0x05, 0x46, 0, 0x05, 0x46, 0x01, 0xE0}};
+    uint8_t today_purified_times{12};
+    uint32_t energy_raw{42};
+    PetkitDeviceId device_id{{0x00, 0x00, 0xA1, 0xB2, 0xC3, 0xD4}};
+    const char *serial{"CTW2SIM0000001"};
+  };
+
+  // Link behaviour
+  struct Link {
+    uint32_t latency_ms{30};      // request -> response delay
+    uint8_t mtu_payload{20};      // notification chunk size (default ATT MTU 23 - 3)
+    uint8_t drop_every{0};        // drop every Nth response (0 = never)
+    bool ack_writes{true};        // answer CMD73/86/84/220/221/222 with an ACK
+    bool extended_e6{true};       // E6 with purified-times/energy tail
+    bool require_secret{true};    // NAK CMD73/86 with a wrong secret
+    uint8_t nak_cmd{0};           // answer this write with ACK status 0 and ignore it (0 = none)
+    uint8_t ignore_cmd{0};        // never answer this request (0 = none)
+  };
+
+  struct Stats {
+    uint32_t requests{0};
+    uint32_t responses{0};
+    uint32_t notifications{0};
+    uint32_t dropped{0};
+    uint32_t rejected{0};  // frames that failed to decode
+    uint32_t per_cmd[256]{};
+  };
+
+  State state;
+  Link link;
+  Stats stats;
+
+  // A frame written by the client at `now_ms`.
+  void on_write(const uint8_t *frame, size_t len, uint32_t now_ms) {
+    PetkitFrame f;
+    if (!petkit_decode_frame_(frame, len, f) || f.type != PETKIT_TYPE_REQUEST) {
+      stats.rejected++;
+      return;
+    }
+    stats.requests++;
+    stats.per_cmd[f.cmd]++;
+    if (f.cmd == link.ignore_cmd) return;
+    if (f.cmd == link.nak_cmd) {
+      ack_(f.cmd, f.seq, 0, now_ms);
+      return;
+    }
+
+    switch (f.cmd) {
+      case 213: respond_identifiers_(f.seq, now_ms); break;
+      case 73: ack_(f.cmd, f.seq, secret_ok_(f, 2 + 8) ? 1 : 0, now_ms); break;
+      case 86: ack_(f.cmd, f.seq, secret_ok_(f, 2) ? 1 : 0, now_ms); break;
+      case 84: ack_(f.cmd, f.seq, 1, now_ms); break;
+      case 210: respond_state_(f.seq, now_ms); break;
+      case 211: respond_config_(f.seq, now_ms); break;
+      case 220:
+        if (f.data_len >= 2) {
+          state.power = f.data[0];
+          state.mode = f.data[1];
+        }
+        ack_(f.cmd, f.seq, 1, now_ms);
+        push_state(now_ms + link.latency_ms);
+        break;
+      case 221:
+        if (f.data_len == PETKIT_CONFIG_LEN) std::memcpy(state.config.data(), f.data, PETKIT_CONFIG_LEN);
+        ack_(f.cmd, f.seq, f.data_len == PETKIT_CONFIG_LEN ? 1 : 0, now_ms);
+        break;
+      case 222:
+        state.filter_percent = 100;
+        state.filter_warn = 0;
+        ack_(f.cmd, f.seq, 1, now_ms);
+        break;
+      default:
+        break;
+    }
+  }
+
+  // Schedules an unsolicited E6 push at `at_ms`.
+  void push_state(uint32_t at_ms) {
+    std::array<uint8_t, 34> d{};
+    d[0] = state.power;
+    d[1] = state.mode;
+    d[2] = state.night_dnd;
+    d[3] = state.breakdown_warn;
+    d[4] = state.lack_warn;
+    d[5] = state.filter_warn;
+    put_u32_(d.data() + 6, state.pump_runtime);
+    d[10] = state.filter_percent;
+    d[11] = state.run_status;
+    put_u32_(d.data() + 12, state.today_runtime);
+    std::memcpy(d.data() + 16, state.config.data(), PETKIT_CONFIG_LEN);
+    d[PETKIT_E6_PURIFIED_OFFSET] = state.today_purified_times;
+    put_u32_(d.data() + PETKIT_E6_ENERGY_OFFSET, state.energy_raw);
+    queue_(0xE6, PETKIT_TYPE_RESPONSE, 0, d.data(), link.extended_e6 ? d.size() : PETKIT_E6_MIN_LEN, at_ms, false);
+  }
+
+  // Delivers every notification due at `now_ms`: fn(const uint8_t *value, size_t len),
+  // each chunk at most link.mtu_payload bytes. Frames due in the same tick go out in the
+  // order they were queued.
+  template<typename F> void poll(uint32_t now_ms, F &&notify) {
+    for (size_t i = 0; i < count_;) {
+      Pending &p = pending_[i];
+      if ((int32_t) (now_ms - p.at_ms) < 0) {
+        i++;
+        continue;
+      }
+      const size_t chunk = link.mtu_payload == 0 ? p.len : link.mtu_payload;
+      for (size_t off = 0; off < p.len; off += chunk) {
+        notify(p.frame.data() + off, std::min(chunk, p.len - off));
+        stats.notifications++;
+      }
+      std::move(pending_.begin() + i + 1, pending_.begin() + count_, pending_.begin() + i);
+      count_--;
+    }
+  }
+
+  bool idle() const { return count_ == 0; }
+
+ protected:
+  static constexpr size_t MAX_PENDING = 16;
+  static constexpr size_t MAX_FRAME = 64;
+
+  struct Pending {
+    uint32_t at_ms{0};
+    size_t len{0};
+    std::array<uint8_t, MAX_FRAME> frame{};
+  };
+
+  static void put_u32_(uint8_t *p, uint32_t v) {
+    p[0] = (v >> 24) & 0xFF;
+    p[1] = (v >> 16) & 0xFF;
+    p[2] = (v >> 8) & 0xFF;
+    p[3] = v & 0xFF;
+  }
+
+  // CMD73 carries [0,0] + device_id8 + secret, CMD86 [0,0] + secret.
+  bool secret_ok_(const PetkitFrame &f, size_t secret_offset) const {
+    if (!link.require_secret) return true;
+    if (f.data_len < secret_offset + 8) return false;
+    std::array<uint8_t, 8> id8{}, secret{};
+    petkit_compute_secret_(state.device_id, id8, secret);
+    return std::memcmp(f.data + secret_offset, secret.data(), secret.size()) == 0;
+  }
+
+  void respond_identifiers_(uint8_t seq, uint32_t now_ms) {
+    std::array<uint8_t, 2 + 6 + 24> d{};
+    std::memcpy(d.data() + 2, state.device_id.data(), state.device_id.size());
+    size_t n = 2 + 6;
+    for (const char *c = state.serial; *c != '\0' && n < d.size(); c++) d[n++] = (uint8_t) *c;
+    queue_(0xD5, PETKIT_TYPE_RESPONSE, seq, d.data(), n, now_ms + link.latency_ms, true);
+  }
+
+  void respond_state_(uint8_t seq, uint32_t now_ms) {
+    std::array<uint8_t, PETKIT_D2_MIN_LEN> d{};
+    d[0] = state.power;
+    d[1] = state.mode;
+    d[2] = state.night_dnd;
+    d[3] = state.breakdown_warn;
+    d[4] = state.lack_warn;
+    d[5] = state.filter_warn;
+    d[10] = state.filter_percent;
+    d[11] = state.run_status;
+    queue_(0xD2, PETKIT_TYPE_RESPONSE, seq, d.data(), d.size(), now_ms + link.latency_ms, true);
+  }
+
+  void respond_config_(uint8_t seq, uint32_t now_ms) {
+    queue_(0xD3, PETKIT_TYPE_RESPONSE, seq, state.config.data(), state.config.size(), now_ms + link.latency_ms, true);
+  }
+
+  void ack_(uint8_t cmd, uint8_t seq, uint8_t status, uint32_t now_ms) {
+    if (!link.ack_writes) return;
+    queue_(cmd, PETKIT_TYPE_RESPONSE, seq, &status, 1, now_ms + link.latency_ms, true);
+  }
+
+  void queue_(uint8_t cmd, uint8_t type, uint8_t seq, const uint8_t *data, size_t len, uint32_t at_ms,
+              bool droppable) {
+    if (droppable && link.drop_every != 0 && (++response_counter_ % link.drop_every) == 0) {
+      stats.dropped++;
+      return;
+    }
+    if (count_ == MAX_PENDING) {
+      stats.dropped++;
+      return;
+    }
+    Pending &p = pending_[count_];
+    p.len = petkit_encode_cmd_(p.frame.data(), p.frame.size(), seq, cmd, type, data, len);
+    if (p.len == 0) return;
+    p.at_ms = at_ms;
+    count_++;
+    stats.responses++;
+  }
+
+  std::array<Pending, MAX_PENDING> pending_{};
+  size_t count_{0};
+  uint32_t response_counter_{0};
+};
+
+}  // namespace petkit_fountain
+}  // namespace esphome
@@ -0,0 +1,73 @@
+// Model profile selection. Built twice: as profile_test with the auto profile and as
+// profile_ctw2_test with PETKIT_MODEL_PROFILE pinned to CTW2, the way codegen emits it.
+#include "petkit_fountain.h"
+
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+#include "frames.h"
+#include "host.h"
+#include "test_util.h"
+
+using namespace esphome;
+using namespace esphome::petkit_fountain;
+
+#ifdef PETKIT_MODEL_PROFILE
+static constexpr bool PINNED = true;
+static_assert(std::is_same<PetkitModelProfile, PetkitProfileCTW2>::value, "pinned build uses the defined profile");
+#else
+static constexpr bool PINNED = false;
+static_assert(std::is_same<PetkitModelProfile, PetkitProfileAuto>::value, "default build probes the length");
+#endif
+
+static void notify(PetkitFountain &pf, test::Bytes v) {
+  esp_ble_gattc_cb_param_t p{};
+  p.notify.handle = 0x10;
+  p.notify.value = v.data();
+  p.notify.value_len = (uint16_t) v.size();
+  pf.gattc_event_handler(ESP_GATTC_NOTIFY_EVT, 3, &p);
+}
+
+int main() {
+  host::reset();
+  ble_client::BLEClient client;
+  client.add_characteristic(esp32_ble::ESPBTUUID::from_raw("notify"), 0x10);
+  client.add_characteristic(esp32_ble::ESPBTUUID::from_raw("write"), 0x12);
+
+  PetkitFountain pf("service", "notify", "write");
+  sensor::Sensor filter, energy;
+  text_sensor::TextSensor profile;
+  pf.bind_sensor(FIELD_FILTER_PERCENT, &filter);
+  pf.bind_sensor(FIELD_TODAY_ENERGY, &energy);
+  pf.set_model_profile_text_sensor(&profile);
+  pf.set_ble_client_parent(&client);
+  pf.setup();
+  CHECK(profile.state == (PINNED ? "ctw2" : "auto"));
+
+  // tail-less E6: CTW2 rejects it, auto reads it and names the unverified W5 layout
+  notify(pf, test::e6(29));
+  if (PINNED) {
+    CHECK_EQ(filter.publishes, 0);
+    CHECK(profile.state == "ctw2");
+  } else {
+    CHECK_EQ(filter.publishes, 1);
+    CHECK(profile.state == "auto: w5 unverified (E6 29)");
+  }
+
+  // purified byte without energy: no fixed profile has that layout
+  notify(pf, test::e6(31));
+  if (PINNED) {
+    CHECK_EQ(filter.publishes, 0);
+  } else {
+    CHECK(profile.state == "auto: partial tail (E6 31)");
+    CHECK(std::isnan(energy.state));
+  }
+
+  notify(pf, test::e6(34));
+  CHECK_EQ(filter.publishes, 1);
+  CHECK(!std::isnan(energy.state));
+  CHECK(profile.state == (PINNED ? "ctw2" : "auto: ctw2 (E6 34)"));
+
+  return test::result(PINNED ? "profile_ctw2_test" : "profile_test");
+}
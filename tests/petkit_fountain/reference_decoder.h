@@ -0,0 +1,170 @@
+#pragma once
+// Slow reference decoder for the differential checks in fuzz_parsers / fuzz_framer. It is
+// written from the frame layout alone, shares no code with petkit_codec.h and reads every
+// byte through std::vector::at(), so it cannot run past a frame.
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "petkit_codec.h"
+
+namespace ref {
+
+using Bytes = std::vector<uint8_t>;
+
+// FA FC FD cmd type seq len 00 data[len] FB
+struct Frame {
+  bool ok{false};
+  uint8_t cmd{0}, type{0}, seq{0};
+  Bytes data;
+};
+
+inline Frame decode(const Bytes &f) {
+  Frame r;
+  if (f.size() < 9) return r;
+  if (f.at(0) != 0xFA || f.at(1) != 0xFC || f.at(2) != 0xFD || f.at(f.size() - 1) != 0xFB) return r;
+  if (f.size() != 9u + f.at(6)) return r;
+  r.ok = true;
+  r.cmd = f.at(3);
+  r.type = f.at(4);
+  r.seq = f.at(5);
+  for (size_t i = 0; i < f.at(6); i++) r.data.push_back(f.at(8 + i));
+  return r;
+}
+
+inline uint32_t be(const Bytes &d, size_t at, size_t n) {
+  uint32_t v = 0;
+  for (size_t i = 0; i < n; i++) v = (v << 8) | d.at(at + i);
+  return v;
+}
+
+// Collects mismatches between the codec and the reference for one input.
+class Diff {
+ public:
+  void check(bool cond, const char *what, int line) {
+    if (cond) return;
+    if (count_++ == 0) first_ = std::string(what) + " (reference_decoder.h:" + std::to_string(line) + ")";
+  }
+  int count() const { return count_; }
+  const std::string &first() const { return first_; }
+
+ private:
+  int count_{0};
+  std::string first_;
+};
+
+#define REF_CHECK(diff, cond) (diff).check((cond), #cond, __LINE__)
+
+inline void config(Diff &d, const esphome::petkit_fountain::PetkitConfigD3 &c, const Bytes &b, size_t o) {
+  REF_CHECK(d, c.smart_on == b.at(o) && c.smart_off == b.at(o + 1));
+  REF_CHECK(d, c.light_sw == b.at(o + 2) && c.brightness == b.at(o + 3));
+  REF_CHECK(d, c.light_start == be(b, o + 4, 2) && c.light_end == be(b, o + 6, 2));
+  REF_CHECK(d, c.dnd_sw == b.at(o + 8));
+  REF_CHECK(d, c.dnd_start == be(b, o + 9, 2) && c.dnd_end == be(b, o + 11, 2));
+}
+
+// Every profile shares the D2 layout: power, mode, dnd, 3 warnings, ..., filter %, run status.
+template<typename P> void d2(Diff &d, const esphome::petkit_fountain::PetkitFrame &f, const Frame &r) {
+  const auto s = esphome::petkit_fountain::petkit_parse_state_d2_t_<P>(f);
+  const bool ok = r.cmd == 0xD2 && r.type == 2 && r.data.size() >= 12;
+  REF_CHECK(d, s.ok == ok);
+  if (!ok) return;
+  REF_CHECK(d, s.power == r.data.at(0) && s.mode == r.data.at(1) && s.night_dnd == r.data.at(2));
+  REF_CHECK(d, s.breakdown_warn == r.data.at(3) && s.lack_warn == r.data.at(4) && s.filter_warn == r.data.at(5));
+  REF_CHECK(d, s.filter_percent == r.data.at(10) && s.run_status == r.data.at(11));
+}
+
+enum class Tail { NONE, REQUIRED, IF_PRESENT };
+
+// E6: 29 bytes of state + settings, then purified times (29) and energy (30..33) on some models.
+template<typename P>
+void e6(Diff &d, const esphome::petkit_fountain::PetkitFrame &f, const Frame &r, size_t min_len, Tail tail) {
+  const auto s = esphome::petkit_fountain::petkit_parse_state_e6_t_<P>(f);
+  const bool ok = r.cmd == 0xE6 && r.data.size() >= min_len;
+  REF_CHECK(d, s.ok == ok);
+  if (!ok) return;
+  const Bytes &b = r.data;
+  REF_CHECK(d, s.power == b.at(0) && s.mode == b.at(1) && s.night_dnd == b.at(2));
+  REF_CHECK(d, s.breakdown_warn == b.at(3) && s.lack_warn == b.at(4) && s.filter_warn == b.at(5));
+  REF_CHECK(d, s.pump_runtime == be(b, 6, 4) && s.filter_percent == b.at(10) && s.run_status == b.at(11));
+  REF_CHECK(d, s.today_runtime == be(b, 12, 4));
+  config(d, s.config, b, 16);
+  const bool purified = tail == Tail::REQUIRED || (tail == Tail::IF_PRESENT && b.size() > 29);
+  const bool energy = tail == Tail::REQUIRED || (tail == Tail::IF_PRESENT && b.size() >= 34);
+  REF_CHECK(d, s.has_purified_times == purified);
+  if (purified) REF_CHECK(d, s.today_purified_times == b.at(29));
+  REF_CHECK(d, s.has_energy == energy);
+  if (energy) REF_CHECK(d, s.energy_raw == be(b, 30, 4));
+}
+
+// D5: device id at 2..7, serial = longest printable run (>= 6 chars, first one wins), cut to 25.
+inline void d5(Diff &d, const esphome::petkit_fountain::PetkitFrame &f, const Frame &r) {
+  const auto id = esphome::petkit_fountain::petkit_parse_cmd213_(f);
+  const bool ok = r.cmd == 0xD5 && r.data.size() >= 8;
+  REF_CHECK(d, id.ok == ok);
+  if (!ok) return;
+  uint64_t dev = 0;
+  for (size_t i = 0; i < 6; i++) {
+    REF_CHECK(d, id.device_id_bytes.at(i) == r.data.at(2 + i));
+    dev = (dev << 8) | r.data.at(2 + i);
+  }
+  REF_CHECK(d, id.device_id_int == dev);
+  size_t best = 0, best_len = 0;
+  for (size_t i = 0; i < r.data.size(); i++) {
+    size_t j = i;
+    while (j < r.data.size() && r.data.at(j) >= 0x20 && r.data.at(j) <= 0x7E) j++;
+    if (j - i > best_len) {
+      best_len = j - i;
+      best = i;
+    }
+  }
+  const std::string serial =
+      best_len >= 6 ? std::string(r.data.begin() + best, r.data.begin() + best + std::min<size_t>(best_len, 25)) : "";
+  REF_CHECK(d, serial == id.serial.c_str());
+}
+
+// Runs `frame` through petkit_decode_frame_ and every parser (each profile) against the
+// reference. The bytes are copied to an exact-size heap block so a sanitizer sees any
+// read past the frame.
+inline Diff frame(const uint8_t *bytes, size_t len) {
+  using namespace esphome::petkit_fountain;
+  Diff d;
+  const Bytes in(bytes, bytes + len);
+  const Frame r = decode(in);
+  std::unique_ptr<uint8_t[]> exact(new uint8_t[len ? len : 1]);
+  std::copy(bytes, bytes + len, exact.get());
+  PetkitFrame f;
+  const bool ok = petkit_decode_frame_(exact.get(), len, f);
+  REF_CHECK(d, ok == r.ok);
+  if (!ok || !r.ok) return d;
+  REF_CHECK(d, f.cmd == r.cmd && f.type == r.type && f.seq == r.seq && f.data_len == r.data.size());
+
+  d2<PetkitProfileAuto>(d, f, r);
+  d2<PetkitProfileW5>(d, f, r);
+  d2<PetkitProfileCTW2>(d, f, r);
+  d2<PetkitProfileCTW3>(d, f, r);
+  REF_CHECK(d, petkit_parse_state_d2_(f).ok == petkit_parse_state_d2_t_<PetkitProfileAuto>(f).ok);
+
+  const auto cfg = petkit_parse_config_d3_(f);
+  const bool cfg_ok = r.cmd == 0xD3 && r.type == 2 && r.data.size() == 13;
+  REF_CHECK(d, cfg.ok == cfg_ok);
+  if (cfg_ok) config(d, cfg, r.data, 0);
+
+  e6<PetkitProfileAuto>(d, f, r, 29, Tail::IF_PRESENT);
+  e6<PetkitProfileW5>(d, f, r, 29, Tail::NONE);
+  e6<PetkitProfileCTW2>(d, f, r, 34, Tail::REQUIRED);
+  e6<PetkitProfileCTW3>(d, f, r, 34, Tail::REQUIRED);
+  REF_CHECK(d, petkit_parse_state_e6_(f).ok == petkit_parse_state_e6_t_<PetkitProfileAuto>(f).ok);
+
+  d5(d, f, r);
+
+  const auto ack = petkit_parse_ack_(f);
+  const bool ack_ok = r.type == 2 && !r.data.empty();
+  REF_CHECK(d, ack.ok == ack_ok);
+  if (ack_ok) REF_CHECK(d, ack.cmd == r.cmd && ack.seq == r.seq && ack.value == r.data.at(0));
+  return d;
+}
+
+}  // namespace ref
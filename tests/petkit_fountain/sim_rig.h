@@ -0,0 +1,205 @@
+#pragma once
+// Drives a PetkitFountain against PetkitSimFountain through the host stubs: GATT writes
+// are handed to the simulated device, its notifications come back as NOTIFY events, and
+// the clock only moves in step(). Collects per-session link metrics.
+#include <cstdint>
+#include <vector>
+
+#include "host.h"
+#include "petkit_fountain.h"
+#include "petkit_sim.h"
+
+namespace test {
+
+using esphome::petkit_fountain::PetkitFountain;
+using esphome::petkit_fountain::PetkitSimFountain;
+
+struct SessionStats {
+  uint32_t connect_ms{0};      // OPEN event
+  uint32_t first_state_ms{0};  // first state published after connect, 0 = none
+  uint32_t done_ms{0};         // is_session_done() first true, 0 = never
+  uint32_t tx_frames{0};       // frames written while connected (request/response round trips)
+  uint32_t notifications{0};
+  uint32_t connected_ms{0};    // until disconnect, or until now for the open session
+
+  uint32_t time_to_first_state() const { return first_state_ms ? first_state_ms - connect_ms : 0; }
+  uint32_t time_to_done() const { return done_ms ? done_ms - connect_ms : 0; }
+};
+
+class SimRig {
+ public:
+  static constexpr uint16_t NOTIFY_HANDLE = 0x10;
+  static constexpr uint16_t WRITE_HANDLE = 0x12;
+
+  PetkitFountain pf{"service", "notify", "write"};
+  PetkitSimFountain sim;
+  esphome::ble_client::BLEClient client;
+  esphome::sensor::Sensor power;  // FIELD_POWER, marks the arrival of a state frame
+
+  uint32_t write_event_ms{10};   // WRITE_CHAR_EVT after each write
+  uint32_t connect_ms{250};      // set_enabled(true) -> OPEN
+  uint32_t loop_interval_ms{16};  // App loop cadence
+
+  std::vector<SessionStats> sessions;
+
+  // called with true before and false after every call into the component (heap_test)
+  void (*component_call)(bool inside){nullptr};
+
+  // keep_flash: start from the preferences a previous rig left behind
+  explicit SimRig(bool keep_flash = false) {
+    if (keep_flash) {
+      host::reboot();
+    } else {
+      host::reset();
+    }
+    client.add_characteristic(esphome::esp32_ble::ESPBTUUID::from_raw("notify"), NOTIFY_HANDLE);
+    client.add_characteristic(esphome::esp32_ble::ESPBTUUID::from_raw("write"), WRITE_HANDLE);
+    client.on_enabled = [this](bool on) {
+      if (on && !connected_) connect_at_ = host::now_ms + connect_ms;
+      if (!on) {
+        connect_at_ = 0;
+        if (connected_) disconnect();
+      }
+    };
+    pf.bind_sensor(esphome::petkit_fountain::FIELD_POWER, &power);
+    pf.set_ble_client_parent(&client);
+  }
+
+  // setup(), then connect unless setup() disabled the client (duty cycling / manager).
+  void start() {
+    start_ms_ = host::now_ms;
+    pf.setup();
+    if (client.enabled) connect();
+    next_update_ = host::now_ms + pf.get_update_interval();
+  }
+
+  void connect() {
+    connected_ = true;
+    connect_at_ = 0;
+    sessions.push_back({});
+    sessions.back().connect_ms = host::now_ms;
+    publishes_at_connect_ = power.publishes;
+    writes_seen_ = host::writes.size();
+    event_(ESP_GATTC_OPEN_EVT);
+    event_(ESP_GATTC_SEARCH_CMPL_EVT);
+    event_(ESP_GATTC_WRITE_DESCR_EVT);
+  }
+
+  void disconnect() {
+    if (!connected_) return;
+    close_session_();
+    connected_ = false;
+    write_events_.clear();
+    event_(ESP_GATTC_DISCONNECT_EVT);
+  }
+
+  // Advances the clock 1 ms at a time.
+  void run(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) tick_();
+  }
+
+  // Runs until the open session is done (or `limit_ms` passes). Returns true if done.
+  bool run_until_done(uint32_t limit_ms = 10000) {
+    for (uint32_t i = 0; i < limit_ms; i++) {
+      tick_();
+      if (!sessions.empty() && sessions.back().done_ms != 0) return true;
+    }
+    return false;
+  }
+
+  bool connected() const { return connected_; }
+
+  // Share of the time since start() spent connected.
+  float connected_fraction() const {
+    const uint32_t total = host::now_ms - start_ms_;
+    uint32_t up = 0;
+    for (const auto &s : sessions) up += s.connected_ms;
+    if (connected_) up += host::now_ms - sessions.back().connect_ms;
+    return total == 0 ? 0.0f : float(up) / float(total);
+  }
+
+ protected:
+  void event_(esp_gattc_cb_event_t e, esp_ble_gattc_cb_param_t *p = nullptr) {
+    esp_ble_gattc_cb_param_t none{};
+    enter_();
+    pf.gattc_event_handler(e, client.gattc_if, p ? p : &none);
+    leave_();
+  }
+
+  void enter_() {
+    if (component_call) component_call(true);
+  }
+  void leave_() {
+    if (component_call) component_call(false);
+  }
+
+  void close_session_() {
+    SessionStats &s = sessions.back();
+    s.connected_ms = host::now_ms - s.connect_ms;
+  }
+
+  void tick_() {
+    host::advance(1);
+    const uint32_t now = host::now_ms;
+    if (connect_at_ != 0 && (int32_t) (now - connect_at_) >= 0) connect();
+
+    if (connected_) {
+      while (writes_seen_ < host::writes.size()) {
+        const host::Write &w = host::writes[writes_seen_++];
+        sessions.back().tx_frames++;
+        sim.on_write(w.value.data(), w.value.size(), now);
+        write_events_.push_back(now + write_event_ms);
+      }
+      for (size_t i = 0; i < write_events_.size();) {
+        if ((int32_t) (now - write_events_[i]) < 0) {
+          i++;
+          continue;
+        }
+        write_events_.erase(write_events_.begin() + i);
+        esp_ble_gattc_cb_param_t p{};
+        p.write.handle = WRITE_HANDLE;
+        p.write.status = ESP_GATT_OK;
+        event_(ESP_GATTC_WRITE_CHAR_EVT, &p);
+      }
+      sim.poll(now, [this](const uint8_t *v, size_t n) {
+        std::vector<uint8_t> value(v, v + n);
+        esp_ble_gattc_cb_param_t p{};
+        p.notify.handle = NOTIFY_HANDLE;
+        p.notify.value = value.data();
+        p.notify.value_len = (uint16_t) n;
+        sessions.back().notifications++;
+        event_(ESP_GATTC_NOTIFY_EVT, &p);
+      });
+    } else {
+      writes_seen_ = host::writes.size();  // nothing reaches the device while down
+    }
+
+    if ((now - start_ms_) % loop_interval_ms == 0) {
+      enter_();
+      pf.loop();
+      leave_();
+    }
+    if ((int32_t) (now - next_update_) >= 0) {
+      enter_();
+      pf.update();
+      leave_();
+      next_update_ = now + pf.get_update_interval();
+    }
+
+    if (connected_) {
+      SessionStats &s = sessions.back();
+      if (s.first_state_ms == 0 && power.publishes != publishes_at_connect_) s.first_state_ms = now;
+      if (s.done_ms == 0 && pf.is_session_done(s.connect_ms)) s.done_ms = now;
+    }
+  }
+
+  bool connected_{false};
+  uint32_t connect_at_{0};
+  uint32_t start_ms_{0};
+  uint32_t next_update_{0};
+  uint32_t publishes_at_connect_{0};
+  size_t writes_seen_{0};
+  std::vector<uint32_t> write_events_;
+};
+
+}  // namespace test
@@ -0,0 +1,83 @@
+// Component against the simulated fountain: init chain, reconnect with cached identity,
+// lossy link, same-tick delivery order. Prints time-to-first-state and round trips per session.
+#include <cstdio>
+#include <vector>
+
+#include "sim_rig.h"
+#include "test_util.h"
+
+using test::SimRig;
+
+static void report(const char *name, const SimRig &rig) {
+  for (size_t i = 0; i < rig.sessions.size(); i++) {
+    const auto &s = rig.sessions[i];
+    std::printf("%-16s session %zu: first_state=%ums done=%ums round_trips=%u notifications=%u\n", name, i,
+                (unsigned) s.time_to_first_state(), (unsigned) s.time_to_done(), (unsigned) s.tx_frames,
+                (unsigned) s.notifications);
+  }
+}
+
+static void test_fresh_boot_and_reconnect() {
+  SimRig rig;
+  rig.start();
+  CHECK(rig.run_until_done());
+  CHECK_EQ(rig.sim.stats.rejected, 0);
+  // 213 (after the 1.5 s identity delay), 73, 86, 84, 210, 211
+  CHECK_EQ(rig.sessions[0].tx_frames, 6);
+  CHECK(rig.sessions[0].first_state_ms != 0);
+  CHECK(rig.sessions[0].time_to_first_state() < 2500);
+
+  rig.disconnect();
+  rig.run(1000);
+  rig.connect();
+  CHECK(rig.run_until_done());
+  // identity cached in flash: no CMD213 wait before the chain
+  CHECK(rig.sessions[1].time_to_first_state() < rig.sessions[0].time_to_first_state());
+  CHECK(rig.sessions[1].time_to_first_state() < 1000);
+  report("reconnect", rig);
+}
+
+static void test_lossy_link() {
+  SimRig rig;
+  rig.sim.link.drop_every = 3;  // every third response lost
+  rig.start();
+  CHECK(rig.run_until_done(20000));
+  CHECK(rig.sessions[0].tx_frames > 6);  // lost replies were re-sent
+  report("lossy", rig);
+}
+
+static void test_split_notifications() {
+  SimRig rig;
+  rig.sim.link.mtu_payload = 7;  // every frame spans several notifications
+  rig.start();
+  CHECK(rig.run_until_done());
+  rig.sim.push_state(host::now_ms);
+  rig.run(50);
+  CHECK_EQ(rig.pf.is_session_connected(), true);
+  CHECK(rig.sessions[0].notifications > rig.sessions[0].tx_frames);
+  report("mtu7", rig);
+}
+
+static void test_same_tick_order() {
+  using namespace esphome::petkit_fountain;
+  PetkitSimFountain sim;
+  sim.link.mtu_payload = 0;
+  const uint8_t power[2] = {1, 1};
+  uint8_t frame[32];
+  // ACK 220, E6 push, D2, D3: all due 30 ms later
+  sim.on_write(frame, petkit_encode_cmd_(frame, sizeof(frame), 1, 220, PETKIT_TYPE_REQUEST, power, 2), 0);
+  sim.on_write(frame, petkit_encode_cmd_(frame, sizeof(frame), 2, 210, PETKIT_TYPE_REQUEST, nullptr, 0), 0);
+  sim.on_write(frame, petkit_encode_cmd_(frame, sizeof(frame), 3, 211, PETKIT_TYPE_REQUEST, nullptr, 0), 0);
+  std::vector<uint8_t> order;
+  sim.poll(sim.link.latency_ms, [&](const uint8_t *v, size_t) { order.push_back(v[3]); });
+  CHECK(order == (std::vector<uint8_t>{220, 0xE6, 0xD2, 0xD3}));
+  CHECK(sim.idle());
+}
+
+int main() {
+  test_fresh_boot_and_reconnect();
+  test_same_tick_order();
+  test_lossy_link();
+  test_split_notifications();
+  return test::result("sim_test");
+}
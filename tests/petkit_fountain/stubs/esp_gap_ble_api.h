@@ -0,0 +1,4 @@
+#pragma once
+#include <cstdint>
+
+uint16_t esp_ble_get_cur_sendable_packets_num(uint16_t connid);
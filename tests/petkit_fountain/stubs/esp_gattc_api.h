@@ -0,0 +1,66 @@
+#pragma once
+// Host stand-in for the ESP-IDF GATT client API (types and calls the component uses).
+#include <cstddef>
+#include <cstdint>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef uint8_t esp_gatt_if_t;
+typedef uint8_t esp_bd_addr_t[6];
+
+typedef enum { ESP_GATT_OK = 0, ESP_GATT_ERROR = 0x85 } esp_gatt_status_t;
+
+typedef enum {
+  ESP_GATTC_REG_EVT,
+  ESP_GATTC_OPEN_EVT,
+  ESP_GATTC_CLOSE_EVT,
+  ESP_GATTC_SEARCH_CMPL_EVT,
+  ESP_GATTC_NOTIFY_EVT,
+  ESP_GATTC_WRITE_CHAR_EVT,
+  ESP_GATTC_WRITE_DESCR_EVT,
+  ESP_GATTC_REG_FOR_NOTIFY_EVT,
+  ESP_GATTC_CONNECT_EVT,
+  ESP_GATTC_DISCONNECT_EVT,
+} esp_gattc_cb_event_t;
+
+typedef union {
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    esp_bd_addr_t remote_bda;
+    uint16_t mtu;
+  } open;
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    int reason;
+  } close;
+  struct {
+    uint16_t conn_id;
+    esp_bd_addr_t remote_bda;
+    uint16_t handle;
+    uint16_t value_len;
+    uint8_t *value;
+    bool is_notify;
+  } notify;
+  struct {
+    esp_gatt_status_t status;
+    uint16_t conn_id;
+    uint16_t handle;
+    uint16_t offset;
+  } write;
+  struct {
+    int reason;
+    uint16_t conn_id;
+    esp_bd_addr_t remote_bda;
+  } disconnect;
+} esp_ble_gattc_cb_param_t;
+
+typedef enum { ESP_GATT_WRITE_TYPE_NO_RSP = 1, ESP_GATT_WRITE_TYPE_RSP = 2 } esp_gatt_write_type_t;
+typedef enum { ESP_GATT_AUTH_REQ_NONE = 0 } esp_gatt_auth_req_t;
+
+esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t gattc_if, uint16_t conn_id, uint16_t handle, uint16_t value_len,
+                                   uint8_t *value, esp_gatt_write_type_t write_type, esp_gatt_auth_req_t auth_req);
+esp_err_t esp_ble_gattc_register_for_notify(esp_gatt_if_t gattc_if, esp_bd_addr_t server_bda, uint16_t handle);
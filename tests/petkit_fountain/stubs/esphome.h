@@ -0,0 +1,8 @@
+#pragma once
+// Host stand-in for the ESPHome umbrella header (only what the component uses).
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include "esphome/components/sensor/sensor.h"
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+
+namespace esphome {
+namespace binary_sensor {
+
+class BinarySensor {
+ public:
+  void publish_state(bool state) {
+    this->state = state;
+    publishes++;
+  }
+  bool state{false};
+  uint32_t publishes{0};
+};
+
+}  // namespace binary_sensor
+}  // namespace esphome
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <esp_gattc_api.h>
+#include "esphome/components/esp32_ble/ble_uuid.h"
+
+namespace esphome {
+
+namespace espbt {
+enum class ClientState { INIT, DISCONNECTING, IDLE, DISCOVERED, CONNECTING, CONNECTED, ESTABLISHED };
+}  // namespace espbt
+
+namespace ble_client {
+
+struct BLECharacteristic {
+  esp32_ble::ESPBTUUID uuid;
+  uint16_t handle{0};
+};
+
+// One peer. Characteristics are registered by the test; set_enabled() calls on_enabled so a
+// harness can play the connect/disconnect events.
+class BLEClient {
+ public:
+  void add_characteristic(const esp32_ble::ESPBTUUID &uuid, uint16_t handle) { chars_.push_back({uuid, handle}); }
+  BLECharacteristic *get_characteristic(esp32_ble::ESPBTUUID service, esp32_ble::ESPBTUUID chr) {
+    (void) service;
+    for (auto &c : chars_)
+      if (c.uuid == chr) return &c;
+    return nullptr;
+  }
+  uint8_t *get_remote_bda() { return remote_bda_; }
+  esp_gatt_if_t get_gattc_if() const { return gattc_if; }
+  uint16_t get_conn_id() const { return conn_id; }
+  uint64_t get_address() const { return address; }
+  void set_enabled(bool enabled) {
+    this->enabled = enabled;
+    if (on_enabled) on_enabled(enabled);
+  }
+
+  bool enabled{true};
+  esp_gatt_if_t gattc_if{3};
+  uint16_t conn_id{0};
+  uint64_t address{0xA4C138000001ULL};
+  std::function<void(bool)> on_enabled;
+
+ protected:
+  std::vector<BLECharacteristic> chars_;
+  uint8_t remote_bda_[6]{0xA4, 0xC1, 0x38, 0x00, 0x00, 0x01};
+};
+
+class BLEClientNode {
+ public:
+  virtual ~BLEClientNode() = default;
+  virtual void gattc_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                                   esp_ble_gattc_cb_param_t *param) = 0;
+  BLEClient *parent() { return parent_; }
+  void set_ble_client_parent(BLEClient *parent) { parent_ = parent; }
+
+ protected:
+  BLEClient *parent_{nullptr};
+  espbt::ClientState node_state{espbt::ClientState::IDLE};
+};
+
+}  // namespace ble_client
+}  // namespace esphome
@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+
+namespace esphome {
+namespace esp32_ble {
+
+class ESPBTUUID {
+ public:
+  static ESPBTUUID from_raw(const std::string &data) {
+    ESPBTUUID u;
+    u.raw_ = data;
+    return u;
+  }
+  bool operator==(const ESPBTUUID &o) const { return raw_ == o.raw_; }
+  const std::string &to_string() const { return raw_; }
+
+ protected:
+  std::string raw_;
+};
+
+}  // namespace esp32_ble
+}  // namespace esphome
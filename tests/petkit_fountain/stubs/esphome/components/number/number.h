@@ -0,0 +1,43 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+namespace esphome {
+namespace number {
+
+class Number;
+
+class NumberCall {
+ public:
+  explicit NumberCall(Number *parent) : parent_(parent) {}
+  NumberCall &set_value(float value) {
+    value_ = value;
+    return *this;
+  }
+  void perform();
+
+ protected:
+  Number *parent_;
+  float value_{NAN};
+};
+
+class Number {
+ public:
+  virtual ~Number() = default;
+  NumberCall make_call() { return NumberCall(this); }
+  void publish_state(float state) {
+    this->state = state;
+    publishes++;
+  }
+  float state{NAN};
+  uint32_t publishes{0};
+
+ protected:
+  friend class NumberCall;
+  virtual void control(float value) = 0;
+};
+
+inline void NumberCall::perform() { parent_->control(value_); }
+
+}  // namespace number
+}  // namespace esphome
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+namespace select {
+
+class Select;
+
+class SelectCall {
+ public:
+  explicit SelectCall(Select *parent) : parent_(parent) {}
+  SelectCall &set_option(const std::string &option) {
+    option_ = option;
+    return *this;
+  }
+  void perform();
+
+ protected:
+  Select *parent_;
+  std::string option_;
+};
+
+class Select {
+ public:
+  virtual ~Select() = default;
+  SelectCall make_call() { return SelectCall(this); }
+  void publish_state(const std::string &state) {
+    this->state = state;
+    publishes++;
+  }
+  std::string state;
+  uint32_t publishes{0};
+
+ protected:
+  friend class SelectCall;
+  virtual void control(const std::string &value) = 0;
+};
+
+inline void SelectCall::perform() { parent_->control(option_); }
+
+}  // namespace select
+}  // namespace esphome
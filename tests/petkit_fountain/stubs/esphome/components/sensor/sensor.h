@@ -0,0 +1,19 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+namespace esphome {
+namespace sensor {
+
+class Sensor {
+ public:
+  void publish_state(float state) {
+    this->state = state;
+    publishes++;
+  }
+  float state{NAN};
+  uint32_t publishes{0};
+};
+
+}  // namespace sensor
+}  // namespace esphome
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+
+namespace esphome {
+namespace switch_ {
+
+class Switch {
+ public:
+  virtual ~Switch() = default;
+  void turn_on() { write_state(true); }
+  void turn_off() { write_state(false); }
+  void publish_state(bool state) {
+    this->state = state;
+    publishes++;
+  }
+  bool state{false};
+  uint32_t publishes{0};
+
+ protected:
+  virtual void write_state(bool state) = 0;
+};
+
+}  // namespace switch_
+}  // namespace esphome
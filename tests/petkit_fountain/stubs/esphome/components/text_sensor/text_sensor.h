@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+namespace text_sensor {
+
+class TextSensor {
+ public:
+  void publish_state(const std::string &state) {
+    this->state = state;
+    publishes++;
+  }
+  std::string state;
+  uint32_t publishes{0};
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
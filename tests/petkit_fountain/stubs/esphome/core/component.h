@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+
+namespace esphome {
+
+namespace setup_priority {
+static constexpr float DATA = 600.0f;
+static constexpr float AFTER_BLUETOOTH = 700.0f;
+static constexpr float LATE = -100.0f;
+}  // namespace setup_priority
+
+class Component {
+ public:
+  virtual ~Component() = default;
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const { return 0.0f; }
+};
+
+class PollingComponent : public Component {
+ public:
+  PollingComponent() = default;
+  explicit PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+  virtual void update() = 0;
+  uint32_t get_update_interval() const { return update_interval_; }
+  void set_update_interval(uint32_t ms) { update_interval_ = ms; }
+
+ protected:
+  uint32_t update_interval_{0};
+};
+
+}  // namespace esphome
@@ -0,0 +1,8 @@
+#pragma once
+#include <cstdint>
+
+namespace esphome {
+// Host clock, driven by the test (see host.h).
+uint32_t millis();
+uint32_t micros();
+}  // namespace esphome
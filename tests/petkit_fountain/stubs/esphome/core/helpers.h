@@ -0,0 +1,7 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+uint32_t fnv1_hash(const std::string &str);
+}  // namespace esphome
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace esphome {
+
+// Backed by an in-memory store in host.cpp (see host::prefs()).
+class ESPPreferenceObject {
+ public:
+  ESPPreferenceObject() = default;
+  ESPPreferenceObject(uint32_t key, size_t size) : key_(key), size_(size) {}
+
+  template<typename T> bool save(const T *src) {
+    return size_ == sizeof(T) && save_bytes_(reinterpret_cast<const uint8_t *>(src));
+  }
+  template<typename T> bool load(T *dest) {
+    return size_ == sizeof(T) && load_bytes_(reinterpret_cast<uint8_t *>(dest));
+  }
+
+ protected:
+  bool save_bytes_(const uint8_t *src);
+  bool load_bytes_(uint8_t *dest);
+
+  uint32_t key_{0};
+  size_t size_{0};
+};
+
+class ESPPreferences {
+ public:
+  template<typename T> ESPPreferenceObject make_preference(uint32_t key, bool in_flash = false) {
+    (void) in_flash;
+    return ESPPreferenceObject(key, sizeof(T));
+  }
+};
+
+extern ESPPreferences *global_preferences;
+
+}  // namespace esphome
@@ -0,0 +1,103 @@
+#include "host.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "esphome.h"
+#include "esphome/components/ble_client/ble_client.h"
+#include <esp_gap_ble_api.h>
+#include <esp_heap_caps.h>
+
+namespace host {
+
+uint32_t now_ms = BOOT_MS;
+std::vector<Write> writes;
+esp_err_t write_result = ESP_OK;
+uint16_t sendable_packets = 4;
+size_t heap_free = 200000;
+size_t heap_largest = 100000;
+int log_level = ESPHOME_LOG_LEVEL_WARN;
+uint32_t log_lines = 0;
+int stub_busy = 0;
+
+static std::map<uint32_t, std::vector<uint8_t>> &prefs() {
+  static std::map<uint32_t, std::vector<uint8_t>> store;
+  return store;
+}
+
+void reboot() {
+  now_ms = BOOT_MS;
+  writes.clear();
+  write_result = ESP_OK;
+  sendable_packets = 4;
+  log_lines = 0;
+}
+
+void reset() {
+  reboot();
+  prefs().clear();
+}
+
+}  // namespace host
+
+namespace esphome {
+
+uint32_t millis() { return host::now_ms; }
+uint32_t micros() { return host::now_ms * 1000u; }
+
+uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= static_cast<uint8_t>(c);
+  }
+  return hash;
+}
+
+void host_log(int level, const char *tag, const char *format, ...) {
+  host::log_lines++;
+  if (level > host::log_level) return;
+  static const char LETTERS[] = "?EWICDVV";
+  std::fprintf(stderr, "[%c][%s] ", LETTERS[level & 7], tag);
+  va_list args;
+  va_start(args, format);
+  std::vfprintf(stderr, format, args);
+  va_end(args);
+  std::fputc('\n', stderr);
+}
+
+static ESPPreferences host_preferences;
+ESPPreferences *global_preferences = &host_preferences;
+
+bool ESPPreferenceObject::save_bytes_(const uint8_t *src) {
+  host::prefs()[key_].assign(src, src + size_);
+  return true;
+}
+
+bool ESPPreferenceObject::load_bytes_(uint8_t *dest) {
+  auto it = host::prefs().find(key_);
+  if (it == host::prefs().end() || it->second.size() != size_) return false;
+  std::memcpy(dest, it->second.data(), size_);
+  return true;
+}
+
+}  // namespace esphome
+
+esp_err_t esp_ble_gattc_write_char(esp_gatt_if_t, uint16_t conn_id, uint16_t handle, uint16_t value_len,
+                                   uint8_t *value, esp_gatt_write_type_t write_type, esp_gatt_auth_req_t) {
+  if (host::write_result != ESP_OK) return host::write_result;
+  host::stub_busy++;
+  host::writes.push_back({conn_id, handle, write_type, std::vector<uint8_t>(value, value + value_len)});
+  host::stub_busy--;
+  return ESP_OK;
+}
+
+esp_err_t esp_ble_gattc_register_for_notify(esp_gatt_if_t, esp_bd_addr_t, uint16_t) { return ESP_OK; }
+
+uint16_t esp_ble_get_cur_sendable_packets_num(uint16_t) { return host::sendable_packets; }
+
+size_t heap_caps_get_free_size(uint32_t) { return host::heap_free; }
+size_t heap_caps_get_largest_free_block(uint32_t) { return host::heap_largest; }
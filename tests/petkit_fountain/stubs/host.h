@@ -0,0 +1,36 @@
+#pragma once
+// Knobs the host stubs expose to tests: clock, recorded GATT writes, controller credits, heap.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <esp_gattc_api.h>
+
+namespace host {
+
+struct Write {
+  uint16_t conn_id;
+  uint16_t handle;
+  esp_gatt_write_type_t type;
+  std::vector<uint8_t> value;
+};
+
+extern uint32_t now_ms;               // millis()
+extern std::vector<Write> writes;     // every esp_ble_gattc_write_char() call, in order
+extern esp_err_t write_result;        // returned by esp_ble_gattc_write_char()
+extern uint16_t sendable_packets;     // esp_ble_get_cur_sendable_packets_num()
+extern size_t heap_free;              // heap_caps_get_free_size()
+extern size_t heap_largest;           // heap_caps_get_largest_free_block()
+extern int log_level;                 // ESPHOME_LOG_LEVEL_* printed to stderr
+extern uint32_t log_lines;            // lines emitted at any level, printed or not
+extern int stub_busy;                 // > 0 while a stub records for the test (heap_test skips it)
+
+inline void advance(uint32_t ms) { now_ms += ms; }
+
+// A fresh boot: clock back to BOOT_MS, writes, preferences and counters cleared.
+constexpr uint32_t BOOT_MS = 1000;
+void reset();
+// Like reset(), but preferences survive (a reboot of the same device).
+void reboot();
+
+}  // namespace host
@@ -0,0 +1,35 @@
+#pragma once
+// Minimal check macros: a failed check prints file:line and the test exits non-zero.
+#include <cstdio>
+
+namespace test {
+inline int &failures() {
+  static int n = 0;
+  return n;
+}
+inline int result(const char *name) {
+  if (failures() == 0) {
+    std::printf("%s: ok\n", name);
+    return 0;
+  }
+  std::printf("%s: %d check(s) failed\n", name, failures());
+  return 1;
+}
+}  // namespace test
+
+#define CHECK(cond) \
+  do { \
+    if (!(cond)) { \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      test::failures()++; \
+    } \
+  } while (0)
+
+#define CHECK_EQ(a, b) \
+  do { \
+    const long long va_ = (long long) (a), vb_ = (long long) (b); \
+    if (va_ != vb_) { \
+      std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, va_, vb_); \
+      test::failures()++; \
+    } \
+  } while (0)